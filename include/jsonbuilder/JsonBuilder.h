@@ -16,6 +16,8 @@ Summary:
   Interface to a value that is stored in a JsonBuilder.
 - class JsonBuilder
   Object that stores a tree of values.
+- class JsonTemplate
+  Prototype JsonBuilder that can be quickly copied and then filled in.
 - class JsonImplementType<T>
   Traits type used to extend JsonBuilder to work with a user-defined type.
 
@@ -37,14 +39,24 @@ JsonBuilder design decisions:
   stored as signed-integer (1, 2, 4, or 8 bytes), unsigned-integer (1, 2, 4, or
   8 bytes), floating-point (4 or 8 bytes), boolean (true/false), null, time
   (in 100ns units since 1601, i.e. Windows FILETIME), UUID (big-endian order),
-  and string (UTF-8). The convenience methods and the renderer can be extended
-  if other types are needed.
+  string (UTF-8), binary (rendered as Base64), and packed arrays of 32/64-bit
+  integers or floating-point values. The convenience methods and the
+  renderer can be extended if other types are needed.
+- The convenience methods also accept std::optional<T> (stored as T or null),
+  std::vector<T>, std::array<T, N> and std::span<T> (stored as an Array), and
+  std::map<string, T> (stored as an Object), reserving storage for the whole
+  container at once.
+- JSONBUILDER_REFLECT(Type, fields...) lets the convenience methods accept a
+  user-defined struct, stored as an Object with one child per listed field.
+- Packed arrays (e.g. JsonDoubleArray) store all of their elements in a single
+  simple node, i.e. 12 bytes of overhead for the whole array instead of 12
+  bytes per element. They render exactly like an Array of the same values.
 - Complex nodes come in two types: Object and Array. The JsonBuilder itself
   makes no distinction between these two types (they have identical behavior)
   but it is intended that the Object type contain named values (i.e. it is a
   dictionary with string keys) and that the Array type contain anonymous values
   (i.e. it is a list).
-- Value name limited to 16M bytes (UTF-8) per value.
+- Value name limited to 8M bytes (UTF-8) per value.
 - Value data limited to 3GB per value.
 - Names are stored as UTF-8.
 - Memory usage for Complex (object and array) values is (in bytes):
@@ -84,10 +96,24 @@ namespace jsonbuilder
 
 #pragma once
 
+#include <array>        // std::array
 #include <chrono>       // std::chrono::system_clock::time_point
 #include <iterator>     // std::forward_iterator_tag
+#include <map>          // std::map
+#include <optional>     // std::optional
+#include <string>       // std::basic_string
 #include <string_view>  // std::string_view
 #include <type_traits>  // std::decay
+#include <vector>       // std::vector
+
+#if defined(__has_include)
+#if __has_include(<version>)
+#include <version>      // __cpp_lib_span
+#endif
+#endif
+#ifdef __cpp_lib_span
+#include <span>         // std::span
+#endif
 
 #ifdef _WIN32
 #include <sal.h>
@@ -126,6 +152,7 @@ namespace jsonbuilder {
 
 class JsonValue;
 class JsonBuilder;
+class JsonTemplate;
 template<class T>
 class JsonImplementType;
 
@@ -153,6 +180,9 @@ using JSON_PTRDIFF_T = decltype((char*)0 - (char*)0);
 static_assert(sizeof(JSON_UINT32) == 4, "Bad UINT32");
 static_assert(sizeof(JSON_UINT64) == 8, "Bad UINT64");
 
+template<class T, class = void>
+struct StorageSizeHint; // Defined after JsonBuilder.
+
 /*
 PodVector:
 
@@ -240,14 +270,15 @@ class PodVector : private PodVectorBase
     size_type m_size;
     size_type m_capacity;
     bool m_zeroInitializeMemory;
+    bool m_attached;               // True if m_data is a caller-owned buffer (see attach()).
 
   public:
     using PodVectorBase::size_type;
 
-    ~PodVector() noexcept { Deallocate(m_data); }
+    ~PodVector() noexcept { ReleaseData(); }
 
     PodVector() noexcept
-        : m_data(nullptr), m_size(0), m_capacity(0), m_zeroInitializeMemory(false)
+        : m_data(nullptr), m_size(0), m_capacity(0), m_zeroInitializeMemory(false), m_attached(false)
     {
         return;
     }
@@ -257,11 +288,13 @@ class PodVector : private PodVectorBase
         , m_size(other.m_size)
         , m_capacity(other.m_capacity)
         , m_zeroInitializeMemory(other.m_zeroInitializeMemory)
+        , m_attached(other.m_attached)
     {
         other.m_data = nullptr;
         other.m_size = 0;
         other.m_capacity = 0;
         other.m_zeroInitializeMemory = false;
+        other.m_attached = false;
     }
 
     PodVector(PodVector const& other)
@@ -270,6 +303,7 @@ class PodVector : private PodVectorBase
         , m_size(other.m_size)
         , m_capacity(other.m_size)
         , m_zeroInitializeMemory(other.m_zeroInitializeMemory)
+        , m_attached(false)
     {
         if (m_size != 0)
         {
@@ -287,6 +321,7 @@ class PodVector : private PodVectorBase
         , m_size(size)
         , m_capacity(size)
         , m_zeroInitializeMemory(false)
+        , m_attached(false)
     {
         if (m_size != 0)
         {
@@ -414,10 +449,35 @@ class PodVector : private PodVectorBase
         auto const z = m_zeroInitializeMemory;
         m_zeroInitializeMemory = other.m_zeroInitializeMemory;
         other.m_zeroInitializeMemory = z;
+
+        auto const a = m_attached;
+        m_attached = other.m_attached;
+        other.m_attached = a;
     }
 
     void EnableZeroInitializeMemory() { m_zeroInitializeMemory = true; }
 
+    /*
+    Discards the current contents and makes the vector use the caller-owned
+    buffer pItems (size 0, capacity cItems) instead of allocating. The vector
+    never frees pItems. If the vector needs to grow, it copies its contents
+    to an allocated buffer as usual and stops using pItems. pItems must stay
+    valid until then or until the vector is destroyed.
+    */
+    void attach(T* pItems, size_type cItems) noexcept
+    {
+        ReleaseData();
+        m_data = pItems;
+        m_size = 0;
+        m_capacity = cItems;
+        m_attached = true;
+    }
+
+    /*
+    Returns true if the vector is using the buffer from attach().
+    */
+    bool attached() const noexcept { return m_attached; }
+
     /*
     Ensures capacity for at least cItems additional elements, then returns
     a pointer to the current end of the vector. Caller can write to this
@@ -445,6 +505,18 @@ class PodVector : private PodVectorBase
     }
 
   private:
+    void ReleaseData() noexcept
+    {
+        if (m_attached)
+        {
+            m_attached = false;
+        }
+        else
+        {
+            Deallocate(m_data);
+        }
+    }
+
     void Grow()
         noexcept(false) // may throw bad_alloc, length_error
     {
@@ -463,7 +535,7 @@ class PodVector : private PodVectorBase
         auto const newCapacity = GetNewCapacity(minCapacity, m_maxSize);
         auto const newData = static_cast<T*>(Allocate(newCapacity * sizeof(T), m_zeroInitializeMemory));
         InitData(newData, m_data, m_size * sizeof(T));
-        Deallocate(m_data);
+        ReleaseData();
         m_data = newData;
         m_capacity = newCapacity;
     }
@@ -534,6 +606,15 @@ enum JsonType
     // Numbering for custom types should start at 1. Custom types never have
     // children. Numbering for custom types must not exceed 200.
     JsonTypeReserved = 201,
+    JsonInt32Array = 236,  // No children. Data = packed int32 elements (little-endian).
+    JsonInt64Array,        // No children. Data = packed int64 elements (little-endian).
+    JsonUInt32Array,       // No children. Data = packed uint32 elements (little-endian).
+    JsonUInt64Array,       // No children. Data = packed uint64 elements (little-endian).
+    JsonFloatArray,        // No children. Data = packed float elements (little-endian).
+    JsonDoubleArray,       // No children. Data = packed double elements (little-endian).
+    JsonBinary,            // No children. Data = arbitrary bytes (rendered as Base64).
+    JsonDecimal,           // No children. Data = DecimalStruct (int64 mantissa and
+                           // int32 scale, value = mantissa * 10^-scale).
     JsonTypeBuiltIn = 244,
     JsonUtf8,    // No children. Data = UTF-8 string.
     JsonUInt,    // No children. Data = uint (1, 2, 4, or 8 bytes, little-endian).
@@ -569,7 +650,9 @@ class JsonValueBase
 
     Index m_nextIndex;  // The index of the "next" node. (Nodes form a
                         // singly-linked list).
-    JSON_UINT32 m_cchName : 24;
+    JSON_UINT32 m_cchName : 23;
+    JSON_UINT32 m_escapeFree : 1; // 1 if name (and JsonUtf8 data) need no
+                                  // escaping, 0 if unknown.
     JsonType m_type : 8;
 };
 
@@ -578,7 +661,7 @@ Each value in a JsonBuilder is represented as a JsonValue. Each JsonValue
 stores:
 
 - Type - a value from the JsonType enumeration, or a custom type.
-- Name - UTF-8 string, up to 16M bytes.
+- Name - UTF-8 string, up to 8M bytes.
 - Data - binary blob, up to 3GB.
 
 Note that Object, Array, and hidden values do not contain data.
@@ -664,10 +747,18 @@ class JsonValue : private JsonValueBase
     iteration AT itParent's last child (hidden or not) instead of stopping
     AFTER itParent's last child.
 
+    Each node records whether its name (and its data, for a JsonUtf8 node) is
+    known to contain no characters that must be escaped when rendered as a
+    JSON string. The flag is computed when the name and data are copied in,
+    and is cleared when the data might be modified (i.e. when the mutable
+    Data() is called), so that the renderer can copy such strings without
+    scanning them.
+
     Normal node format:
-     0: m_nextIndex (4 bytes)
-     4: m_cchName   (3 bytes)
-     7: m_type      (1 byte)
+     0: m_nextIndex  (4 bytes)
+     4: m_cchName    (23 bits)
+     6: m_escapeFree (1 bit)
+     7: m_type       (1 byte)
      8: m_cbData    (4 bytes)
     12: Name        (cchName bytes)
     xx: Padding     (to a multiple of StoragePod size)
@@ -676,7 +767,8 @@ class JsonValue : private JsonValueBase
 
     Composite node format (array or object):
      0: m_nextIndex      (4 bytes)
-     4: m_cchName        (3 bytes)
+     4: m_cchName        (23 bits)
+     6: m_escapeFree     (1 bit)
      7: m_type           (1 byte)  // JsonObject, JsonArray.
      8: m_lastChildIndex (4 bytes)
     12: Name             (cchName bytes)
@@ -685,7 +777,8 @@ class JsonValue : private JsonValueBase
 
     Hidden/sentinel node format:
      0: m_nextIndex      (4 bytes)
-     4: m_cchName        (3 bytes)
+     4: m_cchName        (23 bits)
+     6: m_escapeFree     (1 bit)   // 0.
      7: m_type           (1 byte)  // JsonHidden.
     */
 
@@ -730,9 +823,18 @@ class JsonValue : private JsonValueBase
     the length can only be reduced, never increased.
     Note that hidden, object, and array values do not have data, and it is an
     error to call Data() on a value where Type() is hidden, object, or array.
+    Note that this clears IsEscapeFree() for a JsonUtf8 value.
     */
     void* Data(_Out_opt_ unsigned* pcbData = nullptr) noexcept;
 
+    /*
+    Returns true if the value's name, and its data if Type() is JsonUtf8, are
+    known to contain no characters that must be escaped in a JSON string
+    (i.e. no control characters, quotes, or backslashes). Returns false if
+    escaping might be needed. Computed when the value is added.
+    */
+    bool IsEscapeFree() const noexcept;
+
     /*
     Returns true if Type==Null.
     */
@@ -763,6 +865,7 @@ class JsonValue : private JsonValueBase
     - For float data: float, double.
     - For time data: TimeStruct, std::chrono::system_clock::time_point.
     - For UUID data: UuidStruct.
+    - For decimal data: DecimalStruct.
     - Any user-defined type for which JsonImplementType<T>::GetUnchecked exists.
 
     Detailed semantics:
@@ -795,6 +898,7 @@ class JsonValue : private JsonValueBase
     - For float data: float, double.
     - For time data: TimeStruct, std::chrono::system_clock::time_point.
     - For UUID data: UuidStruct.
+    - For decimal data: DecimalStruct.
     - Any user-defined type for which JsonImplementType<T>::ConvertTo exists.
     */
     template<
@@ -818,6 +922,7 @@ Implementation of JsonBuilder::const_iterator.
 class JsonConstIterator
 {
     friend class JsonBuilder;  // JsonBuilder needs to construct const_iterators.
+    friend class JsonTemplate; // JsonTemplate needs to construct const_iterators.
     using Index = JsonInternal::JSON_UINT32;
 
     JsonBuilder const* m_pContainer;
@@ -871,6 +976,7 @@ Implementation of JsonBuilder::iterator.
 class JsonIterator : public JsonConstIterator
 {
     friend class JsonBuilder;  // JsonBuilder needs to construct iterators.
+    friend class JsonTemplate; // JsonTemplate needs to construct iterators.
 
     /*
     A JsonIterator is created by creating a JsonConstIterator and passing it
@@ -923,6 +1029,7 @@ iterator" parameter, use the root() iterator to refer to the root of the tree.
 class JsonBuilder
 {
     friend class JsonConstIterator;
+    friend class JsonTemplate;
     using StoragePod = JsonValue::StoragePod;
     using Index = JsonValue::Index;
     using StorageVec = JsonInternal::PodVector<JsonValue::StoragePod>;
@@ -931,8 +1038,14 @@ class JsonBuilder
     static_assert(sizeof(JsonValueBase) % sizeof(StoragePod) == 0, "Bad JsonValueBase size");
     static_assert(sizeof(JsonValue) % sizeof(StoragePod) == 0, "Bad JsonValue size");
     static constexpr unsigned RootSize = (sizeof(JsonValue) + sizeof(JsonValueBase)) / sizeof(StoragePod);
+    static constexpr unsigned DataHintMax = 0xF0000000u; // Largest cbDataHint accepted by NewValueInit.
 
     StorageVec m_storage;
+    Index m_lastValueIndex; // Most recently committed value (always at the end of m_storage), or 0.
+    bool m_compactIntegers;
+    bool m_trackChanges;
+    JsonInternal::PodVector<Index> m_changes; // Change log (see TrackChanges).
+    JsonInternal::JSON_UINT64 m_changeBase;   // ChangeCount() before m_changes[0].
 
   public:
     using value_type = JsonValue;
@@ -957,7 +1070,10 @@ class JsonBuilder
 
     /*
     Initializes a new instance of the JsonBuilder class, copying its data from
-    other.
+    other. Always copies all of other's storage: adding a value updates
+    existing nodes in place (the parent's last child and the previous
+    sibling), so storage is never shared between builders.
+    O(n).
     */
     JsonBuilder(JsonBuilder const& other)
         noexcept(false);  // may throw bad_alloc
@@ -998,6 +1114,26 @@ class JsonBuilder
     */
     void ValidateData() const noexcept(false);  // May throw bad_alloc, invalid_argument.
 
+    /*
+    Gets a value indicating whether integer values are stored using the
+    smallest width that holds the value.
+    If true, AddValue/push_front/push_back of a signed or unsigned integer
+    stores the value in 1, 2, 4, or 8 bytes, whichever is the smallest that
+    holds the value (e.g. push_back(it, "n", 7ull) stores 1 byte). This
+    reduces memory usage for payloads with many small integers.
+    If false, integers are stored using sizeof() of the source type.
+    Either way, the value has type JsonInt or JsonUInt and reads back the same.
+    Default value is false.
+    */
+    bool CompactIntegers() const noexcept;
+
+    /*
+    Sets a value indicating whether integer values are stored using the
+    smallest width that holds the value. Affects values added after the call.
+    Default value is false.
+    */
+    void CompactIntegers(bool value) noexcept;
+
     iterator begin() noexcept;
     const_iterator begin() const noexcept;
     const_iterator cbegin() const noexcept;
@@ -1086,6 +1222,80 @@ class JsonBuilder
     */
     void swap(JsonBuilder& other) noexcept;
 
+    /*
+    Gets a value indicating whether this JsonBuilder records which values are
+    modified (see ForEachChangeSince). Default value is false.
+    */
+    bool TrackChanges() const noexcept;
+
+    /*
+    Sets a value indicating whether this JsonBuilder records which values are
+    modified. If true, push_front/push_back (and other methods that add
+    values), erase, splice_front/splice_back, append_to_last, MutableData,
+    and JsonTemplate::store record the affected value in a log of up to 1024
+    entries, so that a JsonRenderer with RenderCache(true) can re-render only
+    the parts of the tree that changed.
+    Modifications made directly through a JsonValue (e.g. it->Data() or
+    it->ReduceDataSize()) are not recorded. Use MutableData to modify a
+    value's data in place.
+    The setting is not copied by the copy/move constructors.
+    Default value is false.
+    */
+    void TrackChanges(bool value)
+        noexcept(false); // may throw bad_alloc
+
+    /*
+    Returns a value that identifies the current state of this JsonBuilder for
+    ForEachChangeSince. The value increases each time a change is recorded, and is
+    unique to this JsonBuilder and its contents: it changes to an unrelated
+    value when the contents are replaced (e.g. clear, assignment, swap).
+    Returns 0 if TrackChanges() is false.
+    */
+    JsonInternal::JSON_UINT64 ChangeCount() const noexcept;
+
+    /*
+    Calls fn(itValue) for each change recorded since ChangeCount() returned
+    changeCount. itValue is the modified value, or the array/object (possibly
+    the root) that gained, lost, or reordered children. The same value may be
+    passed more than once. Returns false without calling fn if the changes
+    are not known (the log overflowed, the contents were replaced, or
+    changeCount came from a different JsonBuilder); the caller should then
+    assume that everything changed.
+    O(n), where n is the number of changes since changeCount.
+    */
+    template<class FnTy>
+    bool ForEachChangeSince(
+        JsonInternal::JSON_UINT64 changeCount,
+        FnTy&& fn) const noexcept
+    {
+        auto const count = ChangeCount();
+        if (count == 0 ||
+            changeCount < m_changeBase ||
+            changeCount > count ||
+            (changeCount >> 32) != (m_changeBase >> 32))
+        {
+            return false;
+        }
+
+        for (auto i = static_cast<unsigned>(changeCount - m_changeBase); i != m_changes.size(); i += 1)
+        {
+            fn(const_iterator(this, m_changes[i]));
+        }
+        return true;
+    }
+
+    /*
+    Gets a pointer to the data of the value at itValue so that the data can
+    be modified in place, e.g. *static_cast<int*>(builder.MutableData(it)) = 5.
+    If TrackChanges() is true, records the value as changed. Otherwise the
+    same as itValue->Data(pcbData).
+    Requires: itValue refers to a value in this builder that is not an
+    array or object.
+    */
+    void* MutableData(
+        const_iterator const& itValue,
+        _Out_opt_ unsigned* pcbData = nullptr) noexcept;
+
     /*
     Causes all future memory allocations by this JsonBuilder to be initialized
     to zero.
@@ -1364,6 +1574,7 @@ class JsonBuilder
     - For float data: float, double.
     - For time data: TimeStruct, std::chrono::system_clock::time_point.
     - For UUID data: UuidStruct.
+    - For decimal data: DecimalStruct.
     - Any user-defined type for which JsonImplementType<T>::AddValueCommit
       exists.
 
@@ -1409,6 +1620,7 @@ class JsonBuilder
     - For float data: float, double.
     - For time data: TimeStruct, std::chrono::system_clock::time_point.
     - For UUID data: UuidStruct.
+    - For decimal data: DecimalStruct.
     - Any user-defined type for which JsonImplementType<T>::AddValueCommit
       exists.
 
@@ -1453,6 +1665,7 @@ class JsonBuilder
     - For float data: float, double.
     - For time data: TimeStruct, std::chrono::system_clock::time_point.
     - For UUID data: UuidStruct.
+    - For decimal data: DecimalStruct.
     - Any user-defined type for which JsonImplementType<T>::AddValueCommit
       exists.
 
@@ -1479,6 +1692,109 @@ class JsonBuilder
         return AddValueImpl(false, itParent, nameView, data);
     }
 
+    /*
+    Creates a new value with the given name and type, letting fill write the
+    payload directly into the value's storage. Inserts the value as the first
+    child of itParent.
+
+    Name must be a string-view-like thing (pointer to nul-terminated
+    array of CHARs, or contiguous container of CHARs), where CHAR is one
+    of char, char8_t, char16_t, char32_t, or wchar_t. The string is
+    assumed to be UTF-8, UTF-16, or UTF-32 based on sizeof(CHAR).
+
+    Reserves cbMaxData bytes for the payload, then calls fill to write the
+    payload. fill is called as fill(void* pbData, unsigned cbMaxData) or (if
+    std::span is available) fill(std::span<std::byte> data), and must return
+    the number of bytes actually written, which must not exceed cbMaxData.
+    The value's data size is then reduced to the returned size. If fill
+    throws, the new value is erased and the exception propagates. fill must
+    not modify this JsonBuilder.
+
+    Requires: itParent must reference an array or an object value.
+    Requires: type must not be Array, Object, or Hidden.
+    Returns: an iterator that references the new value. O(1) plus the cost of fill.
+    */
+    template<class NameStringView, class FillFn, class NameChar = typename JsonInternal::StringTypeOk<NameStringView>::type>
+    iterator emplace_front(
+        const_iterator const& itParent,
+        NameStringView const& name,
+        JsonType type,
+        unsigned cbMaxData,
+        FillFn&& fill)
+        noexcept(false) // may throw bad_alloc, length_error, or whatever fill throws
+    {
+        std::basic_string_view<NameChar> nameView{ name };
+        return EmplaceImpl(true, itParent, nameView, type, cbMaxData, fill);
+    }
+
+    /*
+    Creates a new value with the given name and type, letting fill write the
+    payload directly into the value's storage. Inserts the value as the last
+    child of itParent.
+
+    Name must be a string-view-like thing (pointer to nul-terminated
+    array of CHARs, or contiguous container of CHARs), where CHAR is one
+    of char, char8_t, char16_t, char32_t, or wchar_t. The string is
+    assumed to be UTF-8, UTF-16, or UTF-32 based on sizeof(CHAR).
+
+    Reserves cbMaxData bytes for the payload, then calls fill to write the
+    payload. fill is called as fill(void* pbData, unsigned cbMaxData) or (if
+    std::span is available) fill(std::span<std::byte> data), and must return
+    the number of bytes actually written, which must not exceed cbMaxData.
+    The value's data size is then reduced to the returned size. If fill
+    throws, the new value is erased and the exception propagates. fill must
+    not modify this JsonBuilder.
+
+    Example:
+
+    builder.emplace_back(itParent, "text", JsonUtf8, 64,
+        [&](void* pb, unsigned cb) { return FormatText(pb, cb, args); });
+
+    Requires: itParent must reference an array or an object value.
+    Requires: type must not be Array, Object, or Hidden.
+    Returns: an iterator that references the new value. O(1) plus the cost of fill.
+    */
+    template<class NameStringView, class FillFn, class NameChar = typename JsonInternal::StringTypeOk<NameStringView>::type>
+    iterator emplace_back(
+        const_iterator const& itParent,
+        NameStringView const& name,
+        JsonType type,
+        unsigned cbMaxData,
+        FillFn&& fill)
+        noexcept(false) // may throw bad_alloc, length_error, or whatever fill throws
+    {
+        std::basic_string_view<NameChar> nameView{ name };
+        return EmplaceImpl(false, itParent, nameView, type, cbMaxData, fill);
+    }
+
+    /*
+    Appends a string fragment to the data of the most recently added value,
+    growing that value in place. Use this to assemble a string value from
+    fragments without first concatenating them into a temporary string, e.g.
+
+    builder.push_back(itParent, "message", "Prefix: ");
+    builder.append_to_last(part1);
+    builder.append_to_last(part2);
+
+    Fragment must be a string-view-like thing (pointer to nul-terminated
+    array of CHARs, or contiguous container of CHARs), where CHAR is one
+    of char, char8_t, char16_t, char32_t, or wchar_t. The string is
+    assumed to be UTF-8, UTF-16, or UTF-32 based on sizeof(CHAR) and is
+    appended as UTF-8.
+
+    Requires: The most recently added value exists, has not been erased, and
+    is not an Array or Object. (Usually it will be a JsonUtf8 value.)
+    Returns: an iterator that references the updated value. Amortized O(fragment size).
+    */
+    template<class FragmentStringView, class FragmentChar = typename JsonInternal::StringTypeOk<FragmentStringView>::type>
+    iterator append_to_last(FragmentStringView const& fragment)
+        noexcept(false)  // may throw bad_alloc, length_error
+    {
+        std::basic_string_view<FragmentChar> fragmentView{ fragment };
+        using char_type = typename JsonInternal::CharTypeOk<FragmentChar>::char_type;
+        return AppendToLastImpl(fragmentView.size(), reinterpret_cast<char_type const*>(fragmentView.data()));
+    }
+
     /*
     Advanced scenarios: Should only be called by JsonImplementType<T>::AddValueCommit
     that itself was called by JsonBuilder. Sets the size and type of the new value that
@@ -1564,6 +1880,40 @@ private:
         _In_reads_(cchData) char32_t const* pchDataUtf32)
         noexcept(false);  // may throw bad_alloc, length_error
 
+    iterator
+    AppendToLastImpl(
+        JsonInternal::JSON_SIZE_T cchFragment,
+        _In_reads_(cchFragment) char const* pchFragmentUtf8)
+        noexcept(false);  // may throw bad_alloc, length_error
+    iterator
+    AppendToLastImpl(
+        JsonInternal::JSON_SIZE_T cchFragment,
+        _In_reads_(cchFragment) char16_t const* pchFragmentUtf16)
+        noexcept(false);  // may throw bad_alloc, length_error
+    iterator
+    AppendToLastImpl(
+        JsonInternal::JSON_SIZE_T cchFragment,
+        _In_reads_(cchFragment) char32_t const* pchFragmentUtf32)
+        noexcept(false);  // may throw bad_alloc, length_error
+
+    /*
+    Common implementation for AppendToLastImpl. Grows the storage of the last
+    value so that cbMaxAppend bytes can be written after its current data.
+    If reallocation occurred and pFragment pointed into old storage, updates
+    pFragment to the corresponding pointer into new storage.
+    Returns a pointer to the end of the last value's current data.
+    */
+    unsigned char* AppendToLastGrow(
+        unsigned cbMaxAppend,
+        void const*& pFragment)
+        noexcept(false);  // may throw bad_alloc, length_error
+
+    /*
+    Common implementation for AppendToLastImpl. Adds cbAppended to the last
+    value's data size and shrinks storage to fit.
+    */
+    iterator AppendToLastCommit(unsigned cbAppended) noexcept;
+
     /*
     Common implementation for NewValueInit.
     If reallocation occurred and pName pointed into old storage, returns corresponding
@@ -1628,15 +1978,98 @@ private:
         noexcept(false) // may throw bad_alloc, length_error
     {
         using char_type = typename JsonInternal::CharTypeOk<typename NameStringView::value_type>::char_type;
+
+        // Preallocate space for the data (for an array or object, for all of
+        // its children). No real problem if it's too small.
+        auto const cbDataHint =
+            JsonInternal::StorageSizeHint<typename std::decay<T const>::type>::Get(data);
         NewValueInit(
             front,
             itParent,
             reinterpret_cast<char_type const*>(nameView.data()),
             nameView.size(),
-            8u); // Preallocate space for the data. No real problem if it's too small.
+            cbDataHint < DataHintMax ? static_cast<unsigned>(cbDataHint) : DataHintMax);
         return JsonImplementType<typename std::decay<T>::type>::AddValueCommit(*this, data);
     }
 
+    template<class NameStringView, class FillFn>
+    iterator EmplaceImpl(
+        bool front,
+        const_iterator const& itParent,
+        NameStringView nameView,
+        JsonType type,
+        unsigned cbMaxData,
+        FillFn& fill)
+        noexcept(false) // may throw bad_alloc, length_error, or whatever fill throws
+    {
+        using char_type = typename JsonInternal::CharTypeOk<typename NameStringView::value_type>::char_type;
+        NewValueInit(
+            front,
+            itParent,
+            reinterpret_cast<char_type const*>(nameView.data()),
+            nameView.size(),
+            cbMaxData);
+        auto const itValue = EmplaceBegin(type, cbMaxData);
+
+        EmplaceRollback rollback(*this, itValue.m_index);
+        unsigned cbData;
+        auto const pbData = itValue->Data(&cbData);
+        size_type cbActual;
+#ifdef __cpp_lib_span
+        if constexpr (std::is_invocable_v<FillFn&, std::span<std::byte>>)
+        {
+            cbActual = fill(std::span<std::byte>(static_cast<std::byte*>(pbData), cbData));
+        }
+        else
+#endif
+        {
+            cbActual = fill(pbData, cbData);
+        }
+
+        EmplaceEnd(itValue.m_index, cbActual);
+        rollback.Dismiss();
+        return itValue;
+    }
+
+    /*
+    Commits a new value (under construction) with cbMaxData bytes of
+    uninitialized payload. Used by emplace_front/emplace_back.
+    */
+    iterator EmplaceBegin(JsonType type, unsigned cbMaxData)
+        noexcept(false); // may throw bad_alloc, length_error
+
+    /*
+    Reduces the payload of the value created by EmplaceBegin to cbActual
+    bytes and releases the unused storage.
+    */
+    void EmplaceEnd(Index index, size_type cbActual) noexcept;
+
+    /*
+    Erases the value created by EmplaceBegin and releases its payload storage.
+    */
+    void EmplaceAbort(Index index) noexcept;
+
+    class EmplaceRollback
+    {
+        JsonBuilder* m_pBuilder;
+        Index m_index;
+
+    public:
+
+        EmplaceRollback(JsonBuilder& builder, Index index) noexcept
+            : m_pBuilder(&builder), m_index(index) {}
+        EmplaceRollback(EmplaceRollback const&) = delete;
+        void operator=(EmplaceRollback const&) = delete;
+        ~EmplaceRollback()
+        {
+            if (m_pBuilder != nullptr)
+            {
+                m_pBuilder->EmplaceAbort(m_index);
+            }
+        }
+        void Dismiss() noexcept { m_pBuilder = nullptr; }
+    };
+
     static void AssertNotEnd(Index) noexcept;
     static void AssertHidden(JsonType) noexcept;
     void ValidateIterator(const_iterator const&) const noexcept;
@@ -1645,6 +2078,10 @@ private:
         noexcept;  // False if empty() or if iterator is not a parent.
     JsonValue const& GetValue(Index) const noexcept;
     JsonValue& GetValue(Index) noexcept;
+    void LogChange(Index) noexcept; // If tracking changes, record that the
+                                    // value at index was modified.
+    void ResetChanges() noexcept;   // If tracking changes, the contents were
+                                    // replaced: start a new ChangeCount().
     Index FirstChild(Index) const noexcept; // Given array/object index, return
                                             // index of first child.
     Index LastChild(Index) const noexcept;  // Given array/object index, return
@@ -1763,6 +2200,9 @@ private:
                     pPrev = &GetValue(prevIndex);
                     *pTailIndex = pPrev->m_nextIndex;
                     pPrev->m_nextIndex = headIndex;
+
+                    LogChange(itOldParent.m_index);
+                    LogChange(itNewParent.m_index);
                 }
             }
         }
@@ -1774,6 +2214,165 @@ Exchanges the contents of two JsonBuilder objects.
 */
 void swap(JsonBuilder&, JsonBuilder&) noexcept;
 
+/*
+JsonTemplate holds a prototype JsonBuilder for payloads that always have the
+same shape (e.g. a fixed set of envelope fields) where only the values change.
+Instead of building each payload with many push_back calls, instantiate the
+template (one memcpy of the prototype's storage) and then overwrite the
+values that change.
+
+- Build the prototype with placeholder values of the right size, e.g. a
+  0.0 double for a double field, or an empty object for a nested object
+  whose contents vary.
+- Look up slot handles once using slot("name", "childName", ...).
+- For each payload: instantiate(builder), then store(builder, slot, value)
+  for fixed-size values, and push_back(at(builder, slot), ...) to add
+  variable-size values to object/array slots.
+
+Slot handles remain valid for every builder instantiated from the template,
+even after more values are added to the builder.
+*/
+class JsonTemplate
+{
+    using Index = JsonInternal::JSON_UINT32;
+
+    JsonBuilder m_prototype;
+
+  public:
+
+    /*
+    Handle to a value in the prototype. Obtained from JsonTemplate::slot.
+    */
+    class Slot
+    {
+        friend class JsonTemplate;
+        Index m_index;
+
+        explicit Slot(Index index) noexcept : m_index(index) {}
+
+      public:
+
+        /*
+        Initializes an invalid slot.
+        */
+        Slot() noexcept : m_index(0) {}
+
+        /*
+        Returns true if the slot refers to a value (i.e. the slot lookup
+        succeeded).
+        */
+        explicit operator bool() const noexcept { return m_index != 0; }
+    };
+
+    /*
+    Initializes a new instance of the JsonTemplate class using a copy of the
+    specified prototype.
+    */
+    explicit JsonTemplate(JsonBuilder const& prototype)
+        noexcept(false);  // may throw bad_alloc
+
+    /*
+    Initializes a new instance of the JsonTemplate class, taking the data
+    from the specified prototype.
+    */
+    explicit JsonTemplate(JsonBuilder&& prototype) noexcept;
+
+    /*
+    Gets the prototype.
+    */
+    JsonBuilder const& prototype() const noexcept;
+
+    /*
+    Finds the prototype value with the specified name path, starting at the
+    root, e.g. slot("device", "id"). Returns an invalid slot (one that
+    converts to false) if no such value exists. O(n).
+    */
+    template<class... NameTys>
+    Slot slot(
+        std::string_view const& firstName,
+        NameTys const&... additionalNames) const noexcept
+    {
+        return Slot(m_prototype.find(firstName, additionalNames...).m_index);
+    }
+
+    /*
+    Replaces the contents of builder with a copy of the prototype. Reuses
+    builder's existing buffer when it is large enough.
+    NOTE: Invalidates all iterators pointing into builder.
+    */
+    void instantiate(JsonBuilder& builder) const
+        noexcept(false);  // may throw bad_alloc
+
+    /*
+    Returns a new JsonBuilder containing a copy of the prototype.
+    */
+    JsonBuilder instantiate() const
+        noexcept(false);  // may throw bad_alloc
+
+    /*
+    Returns an iterator to the value referenced by slot within builder.
+    Requires: builder was instantiated from this template, slot is valid.
+    */
+    JsonBuilder::iterator at(JsonBuilder& builder, Slot slot) const noexcept;
+
+    /*
+    Returns an iterator to the value referenced by slot within builder.
+    Requires: builder was instantiated from this template, slot is valid.
+    */
+    JsonBuilder::const_iterator at(JsonBuilder const& builder, Slot slot) const noexcept;
+
+    /*
+    Overwrites the data of the value referenced by slot within builder with
+    cbData bytes from pbData. The value's type is unchanged.
+    Requires: builder was instantiated from this template, slot is valid.
+    Requires: the value is not an array/object and its data size is cbData.
+    */
+    void store(
+        JsonBuilder& builder,
+        Slot slot,
+        _In_reads_bytes_(cbData) void const* pbData,
+        unsigned cbData) const noexcept;
+
+    /*
+    Overwrites the data of the value referenced by slot within builder with
+    the bytes of value, e.g. store(builder, slot, 1.5) for a double slot.
+    The value's type is unchanged. T must be trivially copyable.
+    Requires: builder was instantiated from this template, slot is valid.
+    Requires: the value is not an array/object and its data size is sizeof(T).
+
+    If T is an integer type and the slot is a JsonInt or JsonUInt of a
+    different width (e.g. the prototype was built with CompactIntegers set)
+    or signedness (e.g. an int into a JsonUInt slot), value is converted to
+    the slot's type and width instead.
+    Requires: value is representable in the slot's type and width. Build
+    the prototype's integer placeholders with CompactIntegers(false) (or
+    with a placeholder as wide as the largest value to be stored) to avoid
+    narrow slots.
+    */
+    template<class T>
+    void store(JsonBuilder& builder, Slot slot, T const& value) const noexcept
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "store requires a trivially copyable type");
+        if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>)
+        {
+            StoreInteger(builder, slot, &value, sizeof(T), std::is_signed_v<T>);
+        }
+        else
+        {
+            store(builder, slot, &value, sizeof(T));
+        }
+    }
+
+  private:
+
+    void StoreInteger(
+        JsonBuilder& builder,
+        Slot slot,
+        _In_reads_bytes_(cbData) void const* pbData,
+        unsigned cbData,
+        bool isSigned) const noexcept;
+};
+
 /*
 UUID object, network byte order (big-endian), compatible with uuid_t.
 Does NOT use the same byte order as the Windows GUID type.
@@ -1884,6 +2483,39 @@ public:
     }
 };
 
+/*
+Fixed-point decimal number with value Mantissa() * 10^-Scale, e.g. mantissa
+12345 with scale 2 is 123.45. Rendered as an exact JSON number (trailing zeros
+are preserved, so mantissa 150 with scale 2 renders as 1.50).
+*/
+struct DecimalStruct
+{
+private:
+    using JSON_UINT32 = JsonInternal::JSON_UINT32;
+    using JSON_UINT64 = JsonInternal::JSON_UINT64;
+
+public:
+
+    JSON_UINT32 Low;    // Low 32 bits of the mantissa (two's complement).
+    JSON_UINT32 High;   // High 32 bits of the mantissa (two's complement).
+    signed int Scale;   // Digits after the decimal point. May be negative.
+
+    static constexpr DecimalStruct
+    FromValue(long long signed mantissa, signed int scale) noexcept
+    {
+        return {
+            static_cast<JSON_UINT32>(mantissa),
+            static_cast<JSON_UINT32>(static_cast<JSON_UINT64>(mantissa) >> 32),
+            scale };
+    }
+
+    constexpr long long signed
+    Mantissa() const noexcept
+    {
+        return static_cast<long long signed>((static_cast<JSON_UINT64>(High) << 32) | Low);
+    }
+};
+
 /*
 String view using Latin-1 (ISO-8859-1) encoding.
 */
@@ -2005,6 +2637,7 @@ JSON_DECLARE_JsonImplementType(double,, );
 JSON_DECLARE_JsonImplementType(TimeStruct,, );
 JSON_DECLARE_JsonImplementType(std::chrono::system_clock::time_point,, );
 JSON_DECLARE_JsonImplementType(UuidStruct, const&, const&);
+JSON_DECLARE_JsonImplementType(DecimalStruct,, );
 JSON_DECLARE_JsonImplementType_AddValue(latin1_view, );
 JSON_DECLARE_JsonImplementType_AddValue(cp1252_view, );
 
@@ -2080,4 +2713,500 @@ class JsonImplementType<char8_t const*>
 
 #endif // __cpp_lib_char8_t
 
+// Support for standard library containers, inline since they are templates.
+
+namespace JsonInternal
+{
+    /*
+    Returns the number of bytes of builder storage used by a value's header
+    and name (not including the value's data).
+    */
+    constexpr JSON_SIZE_T NodeStorageSize(JSON_SIZE_T cchName) noexcept
+    {
+        return (sizeof(JsonValue) + cchName + sizeof(JSON_UINT32) - 1) & ~JSON_SIZE_T(sizeof(JSON_UINT32) - 1);
+    }
+
+    /*
+    Returns the number of bytes of builder storage used by cbData bytes of a
+    value's data.
+    */
+    constexpr JSON_SIZE_T DataStorageSize(JSON_SIZE_T cbData) noexcept
+    {
+        return (cbData + sizeof(JSON_UINT32) - 1) & ~JSON_SIZE_T(sizeof(JSON_UINT32) - 1);
+    }
+
+    /*
+    Returns the number of bytes needed to store cch characters of type CH
+    after conversion to UTF-8 (worst case).
+    */
+    template<class CH>
+    constexpr JSON_SIZE_T Utf8SizeHint(JSON_SIZE_T cch) noexcept
+    {
+        return cch * (sizeof(CH) == 1 ? 1 : sizeof(CH) == 2 ? 3 : 4);
+    }
+
+    /*
+    StorageSizeHint<T>::Get(data) estimates the number of bytes of builder
+    storage used by the data of a value created by push_back(..., data), e.g.
+    DataStorageSize(8) for a double, or the total size of all children for a
+    container. Used to reserve storage for a whole container at once, so an
+    estimate that is too small only costs an extra reallocation.
+
+    A JsonImplementType<T> specialization can provide its own estimate by
+    implementing static JSON_SIZE_T StorageSize(T const& data).
+    */
+    template<class T, class>
+    struct StorageSizeHint
+    {
+        static constexpr JSON_SIZE_T Get(T const&) noexcept
+        {
+            return DataStorageSize(8);
+        }
+    };
+
+    template<class T>
+    struct StorageSizeHint<T, std::enable_if_t<std::is_arithmetic_v<T>>>
+    {
+        static constexpr JSON_SIZE_T Get(T const&) noexcept
+        {
+            return DataStorageSize(sizeof(T));
+        }
+    };
+
+    template<class CH, class Traits>
+    struct StorageSizeHint<std::basic_string_view<CH, Traits>, void>
+    {
+        static constexpr JSON_SIZE_T Get(std::basic_string_view<CH, Traits> const& data) noexcept
+        {
+            return DataStorageSize(Utf8SizeHint<CH>(data.size()));
+        }
+    };
+
+    template<class T>
+    struct StorageSizeHint<T, std::void_t<decltype(JsonImplementType<T>::StorageSize(std::declval<T const&>()))>>
+    {
+        static JSON_SIZE_T Get(T const& data) noexcept
+        {
+            return JsonImplementType<T>::StorageSize(data);
+        }
+    };
+
+    /*
+    Implementation of JsonImplementType for sequence containers (vector,
+    array, span). Stores the container as an Array with one child per
+    element.
+    */
+    template<class Container>
+    class SequenceImplementType
+    {
+        using value_type = std::remove_cv_t<typename Container::value_type>;
+
+    public:
+
+        static JSON_SIZE_T
+        StorageSize(Container const& data) noexcept
+        {
+            JSON_SIZE_T cb = sizeof(JsonValueBase); // Sentinel.
+            for (value_type const& element : data)
+            {
+                cb += NodeStorageSize(0) + StorageSizeHint<value_type>::Get(element);
+            }
+            return cb;
+        }
+
+        static JsonIterator
+        AddValueCommit(JsonBuilder& builder, Container const& data)
+        {
+            auto const itArray = builder._newValueCommit(JsonArray, 0, nullptr);
+            for (value_type const& element : data)
+            {
+                builder.push_back(itArray, std::string_view(), element);
+            }
+            return itArray;
+        }
+    };
+
+    /*
+    Implementation of JsonImplementType for string-keyed associative
+    containers (map). Stores the container as an Object with one child per
+    entry, named by the entry's key.
+    */
+    template<class Container>
+    class MapImplementType
+    {
+        using key_type = typename Container::key_type;
+        using key_char = typename StringTypeOk<key_type>::type;
+        using mapped_type = typename Container::mapped_type;
+
+    public:
+
+        static JSON_SIZE_T
+        StorageSize(Container const& data) noexcept
+        {
+            JSON_SIZE_T cb = sizeof(JsonValueBase); // Sentinel.
+            for (auto const& entry : data)
+            {
+                std::basic_string_view<key_char> const nameView{ entry.first };
+                cb += NodeStorageSize(Utf8SizeHint<key_char>(nameView.size())) +
+                    StorageSizeHint<mapped_type>::Get(entry.second);
+            }
+            return cb;
+        }
+
+        static JsonIterator
+        AddValueCommit(JsonBuilder& builder, Container const& data)
+        {
+            auto const itObject = builder._newValueCommit(JsonObject, 0, nullptr);
+            for (auto const& entry : data)
+            {
+                builder.push_back(itObject, entry.first, entry.second);
+            }
+            return itObject;
+        }
+    };
+}
+// namespace JsonInternal
+
+/*
+std::basic_string is stored the same way as the corresponding
+std::basic_string_view, e.g. std::string is stored as JsonUtf8.
+*/
+template<class CH, class Traits, class Alloc>
+class JsonImplementType<std::basic_string<CH, Traits, Alloc>>
+{
+public:
+
+    static JsonInternal::JSON_SIZE_T
+    StorageSize(std::basic_string<CH, Traits, Alloc> const& data) noexcept
+    {
+        return JsonInternal::DataStorageSize(JsonInternal::Utf8SizeHint<CH>(data.size()));
+    }
+
+    static JsonIterator
+    AddValueCommit(JsonBuilder& builder, std::basic_string<CH, Traits, Alloc> const& data)
+    {
+        return JsonImplementType<std::basic_string_view<CH>>::AddValueCommit(
+            builder,
+            std::basic_string_view<CH>(data.data(), data.size()));
+    }
+};
+
+/*
+std::optional<T> is stored as T if it has a value, or as null otherwise.
+GetUnchecked and ConvertTo return an empty optional for a null value.
+*/
+template<class T>
+class JsonImplementType<std::optional<T>>
+{
+public:
+
+    static std::optional<T>
+    GetUnchecked(JsonValue const& value) noexcept
+    {
+        return value.IsNull()
+            ? std::optional<T>()
+            : std::optional<T>(JsonImplementType<T>::GetUnchecked(value));
+    }
+
+    static bool
+    ConvertTo(JsonValue const& value, std::optional<T>& result) noexcept
+    {
+        bool success;
+
+        if (value.IsNull())
+        {
+            result.reset();
+            success = true;
+        }
+        else
+        {
+            T converted;
+            success = JsonImplementType<T>::ConvertTo(value, converted);
+            if (success)
+            {
+                result = converted;
+            }
+            else
+            {
+                result.reset();
+            }
+        }
+
+        return success;
+    }
+
+    static JsonInternal::JSON_SIZE_T
+    StorageSize(std::optional<T> const& data) noexcept
+    {
+        return data.has_value()
+            ? JsonInternal::StorageSizeHint<T>::Get(*data)
+            : 0u;
+    }
+
+    static JsonIterator
+    AddValueCommit(JsonBuilder& builder, std::optional<T> const& data)
+    {
+        return data.has_value()
+            ? JsonImplementType<T>::AddValueCommit(builder, *data)
+            : builder._newValueCommit(JsonNull, 0, nullptr);
+    }
+};
+
+/*
+std::vector<T> and std::array<T, N> are stored as an Array with one child per
+element, e.g. push_back(itParent, "names", names) for a vector of strings.
+Elements may be of any type supported by push_back, including containers.
+Storage for all of the elements is reserved at once.
+*/
+template<class T, class Alloc>
+class JsonImplementType<std::vector<T, Alloc>>
+    : public JsonInternal::SequenceImplementType<std::vector<T, Alloc>> {};
+
+template<class T, std::size_t N>
+class JsonImplementType<std::array<T, N>>
+    : public JsonInternal::SequenceImplementType<std::array<T, N>> {};
+
+/*
+std::map<K, T> is stored as an Object with one child per entry, where K is a
+string type (e.g. std::string or std::string_view) that is used as the
+child's name. Storage for all of the entries is reserved at once.
+*/
+template<class K, class T, class Compare, class Alloc>
+class JsonImplementType<std::map<K, T, Compare, Alloc>>
+    : public JsonInternal::MapImplementType<std::map<K, T, Compare, Alloc>> {};
+
+#ifdef __cpp_lib_span // Support packed arrays via std::span, inline so they work even if lib builds as C++17.
+
+namespace JsonInternal
+{
+    /*
+    PackedArrayTypeOk<T>::value is the packed-array JsonType for element type T.
+    Only defined for element types that have a corresponding packed-array type.
+    */
+    template<class T, class = void> struct PackedArrayTypeOk {};
+    template<class T> struct PackedArrayTypeOk<T, std::enable_if_t<
+        std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+        !std::is_same_v<T, char> && !std::is_same_v<T, wchar_t> &&
+        !std::is_same_v<T, char16_t> && !std::is_same_v<T, char32_t> &&
+        (sizeof(T) == 4 || sizeof(T) == 8)>>
+    {
+        static constexpr JsonType value = std::is_signed_v<T>
+            ? (sizeof(T) == 4 ? JsonInt32Array : JsonInt64Array)
+            : (sizeof(T) == 4 ? JsonUInt32Array : JsonUInt64Array);
+    };
+    template<> struct PackedArrayTypeOk<float>
+    {
+        static constexpr JsonType value = JsonFloatArray;
+    };
+    template<> struct PackedArrayTypeOk<double>
+    {
+        static constexpr JsonType value = JsonDoubleArray;
+    };
+
+    /*
+    Default - std::span<T> of other element types is stored as an Array with
+    one child per element, like std::vector<T>.
+    */
+    template<class T, class = void>
+    class SpanImplementType
+        : public SequenceImplementType<std::span<T const>> {};
+
+    template<>
+    class SpanImplementType<std::byte>
+    {
+    public:
+
+        static std::span<std::byte const>
+        GetUnchecked(JsonValue const& value) noexcept
+        {
+            unsigned cb;
+            auto const pb = value.Data(&cb);
+            return { static_cast<std::byte const*>(pb), cb };
+        }
+
+        static bool
+        ConvertTo(JsonValue const& value, std::span<std::byte const>& result) noexcept
+        {
+            bool success;
+
+            if (value.Type() == JsonBinary)
+            {
+                result = GetUnchecked(value);
+                success = true;
+            }
+            else
+            {
+                result = std::span<std::byte const>();
+                success = false;
+            }
+
+            return success;
+        }
+
+        static JsonIterator
+        AddValueCommit(JsonBuilder& builder, std::span<std::byte const> data)
+        {
+            if (data.size() > 0xF0000000)
+            {
+                JsonThrowLengthError("JsonBuilder - cbData too large");
+            }
+
+            return builder._newValueCommit(
+                JsonBinary,
+                static_cast<unsigned>(data.size()),
+                data.data());
+        }
+    };
+
+    template<class T>
+    class SpanImplementType<T, std::void_t<decltype(PackedArrayTypeOk<T>::value)>>
+    {
+        static constexpr JsonType ArrayType = PackedArrayTypeOk<T>::value;
+
+    public:
+
+        static std::span<T const>
+        GetUnchecked(JsonValue const& value) noexcept
+        {
+            unsigned cb;
+            auto const pb = value.Data(&cb);
+            return { static_cast<T const*>(pb), cb / sizeof(T) };
+        }
+
+        static bool
+        ConvertTo(JsonValue const& value, std::span<T const>& result) noexcept
+        {
+            bool success;
+
+            if (value.Type() == ArrayType && value.DataSize() % sizeof(T) == 0)
+            {
+                result = GetUnchecked(value);
+                success = true;
+            }
+            else
+            {
+                result = std::span<T const>();
+                success = false;
+            }
+
+            return success;
+        }
+
+        static JsonIterator
+        AddValueCommit(JsonBuilder& builder, std::span<T const> data)
+        {
+            if (data.size() > 0xF0000000 / sizeof(T))
+            {
+                JsonThrowLengthError("JsonBuilder - cbData too large");
+            }
+
+            return builder._newValueCommit(
+                ArrayType,
+                static_cast<unsigned>(data.size_bytes()),
+                data.data());
+        }
+    };
+}
+// namespace JsonInternal
+
+/*
+std::span<T> (for T = 32/64-bit integer, float, or double) is stored as a
+packed array value, e.g. push_back(itParent, "name", std::span(doubles))
+creates a JsonDoubleArray value. std::span<std::byte> is stored as a
+JsonBinary value. GetUnchecked and ConvertTo return a std::span<T const>
+that refers to the data stored in the builder. std::span of any other
+element type is stored as an Array, like std::vector.
+*/
+template<class T, std::size_t Extent>
+class JsonImplementType<std::span<T, Extent>>
+    : public JsonInternal::SpanImplementType<std::remove_cv_t<T>> {};
+
+#endif // __cpp_lib_span
+
 } // namespace jsonbuilder
+
+/*
+JSONBUILDER_REFLECT(Type, field1, field2, ...) defines JsonImplementType<Type>
+so that push_back(itParent, name, value) stores a Type as an Object with one
+child per listed field, named after the field. Fields may be of any type
+supported by push_back, including containers and other reflected structs.
+Field name lengths are compile-time constants and storage for all of the
+fields is reserved at once. Use at global namespace scope, e.g.
+
+struct Event { int id; std::string message; std::optional<double> value; };
+JSONBUILDER_REFLECT(Event, id, message, value)
+
+Supports up to 32 fields.
+*/
+#define JSONBUILDER_REFLECT(Type, ...)                                              \
+    namespace jsonbuilder {                                                         \
+    template<>                                                                      \
+    class JsonImplementType<Type>                                                   \
+    {                                                                               \
+    public:                                                                         \
+        static JsonInternal::JSON_SIZE_T                                            \
+        StorageSize(Type const& data) noexcept                                      \
+        {                                                                           \
+            return sizeof(JsonValueBase) JSONBUILDER_REFLECT_FOR_EACH_(             \
+                JSONBUILDER_REFLECT_SIZE_, __VA_ARGS__);                            \
+        }                                                                           \
+        static JsonIterator                                                         \
+        AddValueCommit(JsonBuilder& builder, Type const& data)                      \
+        {                                                                           \
+            auto const itObject = builder._newValueCommit(JsonObject, 0, nullptr);  \
+            JSONBUILDER_REFLECT_FOR_EACH_(JSONBUILDER_REFLECT_PUSH_, __VA_ARGS__)   \
+            return itObject;                                                        \
+        }                                                                           \
+    };                                                                              \
+    }
+
+// Implementation details of JSONBUILDER_REFLECT:
+
+#define JSONBUILDER_REFLECT_SIZE_(field)                                            \
+    + JsonInternal::NodeStorageSize(sizeof(#field) - 1)                             \
+    + JsonInternal::StorageSizeHint<std::decay_t<decltype(data.field)>>::Get(data.field)
+#define JSONBUILDER_REFLECT_PUSH_(field)                                            \
+    builder.push_back(itObject, std::string_view(#field, sizeof(#field) - 1), data.field);
+
+#define JSONBUILDER_REFLECT_EXPAND_(x) x
+#define JSONBUILDER_REFLECT_CAT_(a, b) JSONBUILDER_REFLECT_CAT_IMPL_(a, b)
+#define JSONBUILDER_REFLECT_CAT_IMPL_(a, b) a##b
+#define JSONBUILDER_REFLECT_FOR_EACH_(m, ...) JSONBUILDER_REFLECT_EXPAND_( \
+    JSONBUILDER_REFLECT_CAT_(JSONBUILDER_REFLECT_FOR_EACH_, JSONBUILDER_REFLECT_COUNT_(__VA_ARGS__))(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_COUNT_(...) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_COUNT_IMPL_(__VA_ARGS__, \
+    32_, 31_, 30_, 29_, 28_, 27_, 26_, 25_, 24_, 23_, 22_, 21_, 20_, 19_, 18_, 17_, \
+    16_, 15_, 14_, 13_, 12_, 11_, 10_, 9_, 8_, 7_, 6_, 5_, 4_, 3_, 2_, 1_))
+#define JSONBUILDER_REFLECT_COUNT_IMPL_( \
+    _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, N, ...) N
+#define JSONBUILDER_REFLECT_FOR_EACH_1_(m, x) m(x)
+#define JSONBUILDER_REFLECT_FOR_EACH_2_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_1_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_3_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_2_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_4_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_3_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_5_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_4_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_6_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_5_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_7_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_6_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_8_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_7_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_9_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_8_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_10_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_9_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_11_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_10_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_12_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_11_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_13_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_12_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_14_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_13_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_15_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_14_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_16_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_15_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_17_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_16_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_18_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_17_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_19_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_18_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_20_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_19_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_21_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_20_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_22_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_21_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_23_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_22_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_24_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_23_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_25_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_24_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_26_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_25_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_27_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_26_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_28_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_27_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_29_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_28_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_30_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_29_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_31_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_30_(m, __VA_ARGS__))
+#define JSONBUILDER_REFLECT_FOR_EACH_32_(m, x, ...) m(x) JSONBUILDER_REFLECT_EXPAND_(JSONBUILDER_REFLECT_FOR_EACH_31_(m, __VA_ARGS__))
@@ -6,7 +6,12 @@ JsonRenderer converts JsonBuilder trees into utf8 JSON text.
 
 Summary:
 - JsonRenderer
+- JsonRenderCustomFunction
+- JsonRenderToResult
+- JsonSink, JsonCallbackSink, JsonOstreamSink
+- JsonRenderBase64
 - JsonRenderBool
+- JsonRenderDecimal
 - JsonRenderFalse
 - JsonRenderTime
 - JsonRenderFloat
@@ -21,16 +26,149 @@ Summary:
 #pragma once
 
 #include <jsonbuilder/JsonBuilder.h>
+#include <iosfwd>
+#include <utility>
+
+#ifndef _Out_
+#define _Out_
+#endif
+
+#ifndef _Out_writes_
+#define _Out_writes_(c)
+#endif
 
 #ifndef _Out_writes_z_
 #define _Out_writes_z_(c)
 #endif
 
 namespace jsonbuilder {
+
+/*
+Formats for rendering JsonBinary values.
+*/
+enum JsonBinaryFormat : unsigned char
+{
+    JsonBinaryBase64,    // Standard Base64 (RFC 4648 section 4) with '=' padding, e.g. "+/8="
+    JsonBinaryBase64Url, // URL-safe Base64 (RFC 4648 section 5) without padding, e.g. "-_8"
+};
+
+/*
+Formats for rendering JsonFloat values and packed float/double arrays.
+*/
+enum JsonFloatFormat : unsigned char
+{
+    JsonFloatShortest,    // Shortest text that round-trips, e.g. 0.30000000000000004
+    JsonFloatFixed,       // Up to FloatPrecision() digits after the decimal point, e.g. 0.3
+    JsonFloatSignificant, // Up to FloatPrecision() significant digits, e.g. 1.23e+20
+};
+
+/*
+Formats for rendering JsonTime values. The Iso formats render as strings;
+the others render as integers. Epoch formats count from
+1970-01-01T00:00:00Z, rounding toward negative infinity.
+*/
+enum JsonTimeFormat : unsigned char
+{
+    JsonTimeIso,          // "2015-04-02T02:09:14.7927652Z"
+    JsonTimeIsoMicros,    // "2015-04-02T02:09:14.792765Z"
+    JsonTimeIsoMillis,    // "2015-04-02T02:09:14.792Z"
+    JsonTimeIsoSeconds,   // "2015-04-02T02:09:14Z"
+    JsonTimeEpochSeconds, // 1427940554
+    JsonTimeEpochMillis,  // 1427940554792
+    JsonTimeEpochMicros,  // 1427940554792765
+    JsonTimeFileTime,     // 130724141547927652 (100ns intervals since 1601)
+};
+
+/*
+Formats for rendering JsonUuid values.
+*/
+enum JsonUuidFormat : unsigned char
+{
+    JsonUuidUppercase,        // "CD8D0A5E-6409-4B8E-9366-B815CEF0E35D"
+    JsonUuidLowercase,        // "cd8d0a5e-6409-4b8e-9366-b815cef0e35d" (RFC 4122)
+    JsonUuidUppercaseCompact, // "CD8D0A5E64094B8E9366B815CEF0E35D"
+    JsonUuidLowercaseCompact, // "cd8d0a5e64094b8e9366b815cef0e35d"
+};
+
+/*
+Renders a value of a custom type for JsonRenderer (see
+JsonRenderer::CustomRenderer). Should append the utf-8 JSON representation
+of the value referenced by itValue to the end of buffer. context is the
+value that was passed when the function was registered.
+*/
+typedef void JsonRenderCustomFunction(
+    void* context,
+    JsonInternal::PodVector<char>& buffer,
+    JsonBuilder::const_iterator const& itValue);
+
+/*
+Result of JsonRenderer::RenderTo.
+*/
+struct JsonRenderToResult
+{
+    size_t Size;    // Length of the JSON text (not counting nul), even if Truncated.
+    bool Truncated; // True if the JSON text did not fit in the destination.
+};
+
+/*
+Receives JSON text from JsonRenderer::Render(..., JsonSink&) in chunks.
+Derive from JsonSink and override Write to send the text to a file, socket,
+or other destination.
+*/
+class JsonSink
+{
+  public:
+    virtual ~JsonSink();
+
+    /*
+    Called with the next chunk of rendered text. The chunk is not
+    nul-terminated and is only valid for the duration of the call.
+    */
+    virtual void Write(std::string_view chunk)
+        noexcept(false) = 0; // may throw
+};
+
+/*
+JsonSink that forwards each chunk to a callable, e.g.
+JsonCallbackSink sink([&](std::string_view chunk) { send(fd, chunk.data(), chunk.size(), 0); });
+*/
+template<class Callback>
+class JsonCallbackSink final : public JsonSink
+{
+    Callback m_callback;
+
+  public:
+    explicit JsonCallbackSink(Callback callback)
+        : m_callback(std::move(callback))
+    {
+        return;
+    }
+
+    void Write(std::string_view chunk) noexcept(false) override
+    {
+        m_callback(chunk);
+    }
+};
+
+/*
+JsonSink that writes each chunk to a std::ostream. Does not check or change
+the stream's error state.
+*/
+class JsonOstreamSink final : public JsonSink
+{
+    std::ostream& m_stream;
+
+  public:
+    explicit JsonOstreamSink(std::ostream& stream) noexcept;
+
+    void Write(std::string_view chunk) noexcept(false) override;
+};
+
 /*
 Converts JsonBuilder data into utf-8 JSON text.
 Recognizes the built-in JsonType types. To support other (custom) types,
-derive from JsonRenderer and override RenderCustom.
+register a render function for each type with CustomRenderer, or derive
+from JsonRenderer and override RenderCustom.
 */
 class JsonRenderer
 {
@@ -39,11 +177,85 @@ class JsonRenderer
     typedef JsonBuilder::const_iterator iterator;
 
   private:
+    /*
+    A render function registered with CustomRenderer.
+    */
+    struct CustomEntry
+    {
+        JsonRenderCustomFunction* function; // nullptr to use RenderCustom.
+        void* context;
+    };
+
+    /*
+    A name in the rendered-name cache (see NameCache). The name is at
+    m_nameCacheData[offset], followed by its rendered "name": token.
+    */
+    struct NameCacheEntry
+    {
+        unsigned hash;
+        unsigned offset;
+        unsigned cchName;
+        unsigned cchToken; // 0 if the slot is empty.
+    };
+
+    /*
+    What the render cache (see RenderCache) knows about a value, indexed by
+    the value's position in the JsonBuilder's storage. Offsets are relative
+    to the start of the parent's text, so they stay valid when the parent's
+    text is copied to a new position.
+    */
+    struct RenderCacheEntry
+    {
+        unsigned parent; // Entry of the parent array/object, or RenderCacheNone.
+        unsigned offset; // Offset of the array/object's text in the parent's text.
+        unsigned size;   // Size of the array/object's text, or RenderCacheDirty.
+    };
+
+    /*
+    An array or object that is being rendered or measured.
+    */
+    struct StructureFrame
+    {
+        iterator it;       // Next child.
+        iterator itEnd;    // End of children.
+        bool showNames;    // True for object, false for array.
+        bool first;        // True if no children have been processed yet.
+        unsigned node;     // Render cache: entry of this array/object.
+        unsigned start;    // Render cache: offset of '{' or '[' in m_renderBuffer.
+        unsigned oldStart; // Render cache: offset in m_renderCacheText, or RenderCacheNone.
+    };
+
     RenderBuffer m_renderBuffer;
+    RenderBuffer m_newLineIndent; // m_newLine + m_indentChar * N, or empty if not built.
+    JsonInternal::PodVector<NameCacheEntry> m_nameCacheTable; // Open addressing, or empty.
+    RenderBuffer m_nameCacheData;                             // Names and tokens for m_nameCacheTable.
+    unsigned m_nameCacheCount;                                // Number of used slots.
+    bool m_nameCache;
+    unsigned m_threadCount;
+    JsonRenderer* m_owner; // For a parallel-rendering worker, the renderer that started it.
+    JsonInternal::PodVector<StructureFrame> m_structures; // Open arrays and objects.
     std::string_view m_newLine;
     unsigned m_indentSpaces;
+    char m_indentChar;
     unsigned m_indent;
     bool m_pretty;
+    JsonBinaryFormat m_binaryFormat;
+    JsonFloatFormat m_floatFormat;
+    unsigned char m_floatPrecision;
+    JsonTimeFormat m_timeFormat;
+    JsonUuidFormat m_uuidFormat;
+    JsonInternal::JSON_UINT64 m_timeCacheSeconds; // Seconds since 1601 of m_timeCacheText.
+    char m_timeCacheText[19];                      // "YYYY-MM-DDThh:mm:ss" for RenderTime.
+    JsonSink* m_sink;                              // Non-null while rendering to a sink.
+    RenderBuffer::size_type m_chunkSize;           // Size of chunks passed to m_sink.
+    unsigned m_maxDepth;                           // Maximum nesting depth, or 0 for no limit.
+    CustomEntry m_customRenderers[256];            // Indexed by JsonType.
+    bool m_renderCache;
+    JsonInternal::JSON_UINT64 m_renderCacheCount;  // ChangeCount() of the text in m_renderBuffer, or 0.
+    char const* m_renderCacheStorage;              // buffer_data() while rendering with the cache, else nullptr.
+    JsonInternal::PodVector<RenderCacheEntry> m_renderCacheEntries;
+    RenderBuffer m_renderCacheText;                // Previous output while rendering with the cache.
+    RenderBuffer m_renderCacheStorageCopy;         // Debug builds: builder storage at the previous render.
 
   public:
     typedef JsonInternal::PodVector<char>::size_type size_type;
@@ -110,15 +322,196 @@ class JsonRenderer
     void NewLine(std::string_view value) noexcept;
 
     /*
-    Gets the number of spaces per indent level. Default value is 2.
+    Gets the number of IndentChar() characters per indent level.
+    Default value is 2.
     */
     unsigned IndentSpaces() const noexcept;
 
     /*
-    Sets the number of spaces per indent level. Default value is 2.
+    Sets the number of IndentChar() characters per indent level.
+    Default value is 2.
     */
     void IndentSpaces(unsigned value) noexcept;
 
+    /*
+    Gets the character that is used for indentation when Pretty() is true.
+    Default value is ' '.
+    */
+    char IndentChar() const noexcept;
+
+    /*
+    Sets the character that is used for indentation when Pretty() is true.
+    Must be ' ' or '\t', otherwise throws invalid_argument. For one tab per
+    indent level, use IndentChar('\t') with IndentSpaces(1). Default value is
+    ' '.
+    */
+    void IndentChar(char value)
+        noexcept(false); // may throw invalid_argument
+
+    /*
+    Gets a value indicating whether the renderer caches the rendered form
+    of object member names. Default value is false.
+    */
+    bool NameCache() const noexcept;
+
+    /*
+    Sets a value indicating whether the renderer caches the rendered form
+    of object member names. If true, the first time a name that may need
+    escaping is rendered, its complete "name": token (including the space
+    added when Pretty() is true) is saved, and later members with the same
+    name are written with a single copy. Names that are known to need no
+    escaping (see JsonValue::IsEscapeFree) are already written with a single
+    copy and are not cached. Up to 1024 names (64KB) are cached; additional
+    names are rendered normally. Changing this setting or Pretty() clears
+    the cache. Default value is false.
+    */
+    void NameCache(bool value) noexcept;
+
+    /*
+    Gets the format used for JsonBinary values. Default value is
+    JsonBinaryBase64.
+    */
+    JsonBinaryFormat BinaryFormat() const noexcept;
+
+    /*
+    Sets the format used for JsonBinary values. Default value is
+    JsonBinaryBase64.
+    */
+    void BinaryFormat(JsonBinaryFormat value) noexcept;
+
+    /*
+    Gets the format used for floating-point values. Default value is
+    JsonFloatShortest.
+    */
+    JsonFloatFormat FloatFormat() const noexcept;
+
+    /*
+    Sets the format used for floating-point values. Default value is
+    JsonFloatShortest.
+    */
+    void FloatFormat(JsonFloatFormat value) noexcept;
+
+    /*
+    Gets the precision used when FloatFormat() is JsonFloatFixed (digits
+    after the decimal point) or JsonFloatSignificant (significant digits).
+    Default value is 6.
+    */
+    unsigned FloatPrecision() const noexcept;
+
+    /*
+    Sets the precision used when FloatFormat() is JsonFloatFixed (digits
+    after the decimal point) or JsonFloatSignificant (significant digits).
+    Values greater than 17 are treated as 17. Default value is 6.
+    */
+    void FloatPrecision(unsigned value) noexcept;
+
+    /*
+    Gets the format used for JsonTime values. Default value is JsonTimeIso.
+    */
+    JsonTimeFormat TimeFormat() const noexcept;
+
+    /*
+    Sets the format used for JsonTime values. Default value is JsonTimeIso.
+    Requires a valid JsonTimeFormat value, otherwise throws invalid_argument.
+    */
+    void TimeFormat(JsonTimeFormat value)
+        noexcept(false); // may throw invalid_argument
+
+    /*
+    Gets the format used for JsonUuid values. Default value is
+    JsonUuidUppercase.
+    */
+    JsonUuidFormat UuidFormat() const noexcept;
+
+    /*
+    Sets the format used for JsonUuid values. Default value is
+    JsonUuidUppercase.
+    */
+    void UuidFormat(JsonUuidFormat value) noexcept;
+
+    /*
+    Gets the function registered to render values of the specified custom
+    type, or nullptr if values of the type are rendered by RenderCustom.
+    */
+    JsonRenderCustomFunction* CustomRenderer(JsonType type) const noexcept;
+
+    /*
+    Registers a function to render values of the specified custom type.
+    The function is called directly (instead of the virtual RenderCustom
+    method) with the specified context. Set function to nullptr to go back
+    to using RenderCustom for the type.
+    Requires 1 <= type <= 200, otherwise throws invalid_argument.
+    */
+    void CustomRenderer(
+        JsonType type,
+        JsonRenderCustomFunction* function,
+        void* context = nullptr)
+        noexcept(false); // may throw invalid_argument
+
+    /*
+    Gets a value indicating whether Render(builder) reuses the text of
+    arrays and objects that have not changed since the previous
+    Render(builder). Default value is false.
+    */
+    bool RenderCache() const noexcept;
+
+    /*
+    Sets a value indicating whether Render(builder) reuses the text of
+    arrays and objects that have not changed since the previous
+    Render(builder). Only applies to a JsonBuilder with TrackChanges(true).
+    The renderer remembers where each array and object was in the previous
+    output. When the same JsonBuilder is rendered again, the arrays and
+    objects that contain a changed value (see JsonBuilder::TrackChanges)
+    are rendered again, and the others are copied from the previous output,
+    so the time taken is proportional to the size of the changes instead of
+    the size of the document. Uses memory proportional to the size of the
+    builder's storage, and keeps a copy of the previous output.
+    Changing a formatting property, rendering another JsonBuilder, or
+    calling Render(it) or Render(..., sink) causes the next Render(builder)
+    to render everything. Functions registered with CustomRenderer and
+    overrides of RenderCustom must return the same text for the same value.
+    Data must be modified through JsonBuilder::MutableData, not through
+    JsonValue::Data; debug builds assert if a change was not recorded.
+    Rendering with the cache always uses one thread. Default value is false.
+    */
+    void RenderCache(bool value) noexcept;
+
+    /*
+    Gets the maximum number of threads used by Render and RenderTo.
+    Default value is 1.
+    */
+    unsigned ThreadCount() const noexcept;
+
+    /*
+    Sets the maximum number of threads used by Render and RenderTo. If
+    greater than 1, a large array or object is split into ranges of
+    children that are rendered on separate threads and joined in order.
+    Starting at the rendered value, the renderer descends into any array or
+    object that holds most of its parent's builder storage (e.g. the array
+    in {"version":1,"items":[...]}) and splits the structure where it
+    stops. The output is the same as for single-threaded rendering.
+    Structures whose children use less than 256KB of builder storage,
+    rendering to a JsonSink, and rendering with RenderCache, always use one
+    thread. When more than one thread is used, RenderCustom and functions
+    registered with CustomRenderer may be called concurrently and must be
+    thread-safe. Values less than 1 are treated as 1. Default value is 1.
+    */
+    void ThreadCount(unsigned value) noexcept;
+
+    /*
+    Gets the maximum nesting depth of arrays and objects, where the root
+    object is depth 1. Rendering or measuring a deeper value throws
+    length_error. 0 means no limit. Default value is 0.
+    */
+    unsigned MaxDepth() const noexcept;
+
+    /*
+    Sets the maximum nesting depth of arrays and objects, where the root
+    object is depth 1. Rendering or measuring a deeper value throws
+    length_error. 0 means no limit. Default value is 0.
+    */
+    void MaxDepth(unsigned value) noexcept;
+
     /*
     Renders the contents of the specified JsonBuilder as utf-8 JSON, starting
     at the root value.
@@ -144,6 +537,83 @@ class JsonRenderer
     Render(JsonBuilder::const_iterator const& it)
         noexcept(false); // may throw bad_alloc, length_error
 
+    /*
+    Renders the contents of the specified JsonBuilder as utf-8 JSON, starting
+    at the root value, directly into the caller-provided buffer dest.
+    Returns the length of the JSON text. If the text fits (Size <= cchDest),
+    Truncated is false and the text is in dest[0..Size), followed by a nul if
+    Size < cchDest. Otherwise Truncated is true, Size is the cchDest value
+    needed, and the contents of dest are unspecified.
+    The rendering buffer is not used unless the text does not fit, so in the
+    common case nothing is allocated or copied. Does not change the string
+    returned by a previous Render call.
+    */
+    JsonRenderToResult RenderTo(
+        JsonBuilder const& builder,
+        _Out_writes_(cchDest) char* dest,
+        size_t cchDest)
+        noexcept(false); // may throw bad_alloc, length_error
+
+    /*
+    Renders the contents of a JsonBuilder as utf-8 JSON, starting at the
+    specified value, directly into the caller-provided buffer dest. Results
+    are the same as for RenderTo(builder, dest, cchDest).
+    */
+    JsonRenderToResult RenderTo(
+        JsonBuilder::const_iterator const& it,
+        _Out_writes_(cchDest) char* dest,
+        size_t cchDest)
+        noexcept(false); // may throw bad_alloc, length_error
+
+    /*
+    Returns the number of bytes that Render(builder) would produce with the
+    current settings, not counting the nul-termination. Strings and integers
+    are measured without formatting them. Custom values are measured by
+    calling RenderCustom, which may reallocate the rendering buffer and
+    invalidate the string_view returned by a previous Render call.
+    */
+    size_t MeasureSize(JsonBuilder const& builder)
+        noexcept(false); // may throw bad_alloc, length_error
+
+    /*
+    Returns the number of bytes that Render(it) would produce with the
+    current settings, not counting the nul-termination.
+    */
+    size_t MeasureSize(JsonBuilder::const_iterator const& it)
+        noexcept(false); // may throw bad_alloc, length_error
+
+    /*
+    Gets the size of the chunks passed to JsonSink::Write when rendering to a
+    sink. Default value is 65536.
+    */
+    size_type ChunkSize() const noexcept;
+
+    /*
+    Sets the size of the chunks passed to JsonSink::Write when rendering to a
+    sink. Values less than 1 are treated as 1. Default value is 65536.
+    */
+    void ChunkSize(size_type value) noexcept;
+
+    /*
+    Renders the contents of the specified JsonBuilder as utf-8 JSON, starting
+    at the root value, and passes the text to sink in chunks.
+    Each chunk except the last is exactly ChunkSize() bytes. The rendering
+    buffer holds less than ChunkSize() bytes plus the largest single value,
+    so memory use does not grow with the size of the document. No
+    nul-termination is written. After this call, the rendering buffer is
+    empty.
+    */
+    void Render(JsonBuilder const& builder, JsonSink& sink)
+        noexcept(false); // may throw bad_alloc, length_error, or sink exceptions
+
+    /*
+    Renders the contents of a JsonBuilder as utf-8 JSON, starting at the
+    specified value, and passes the text to sink in chunks. Chunking is the
+    same as for Render(builder, sink).
+    */
+    void Render(JsonBuilder::const_iterator const& it, JsonSink& sink)
+        noexcept(false); // may throw bad_alloc, length_error, or sink exceptions
+
   protected:
     /*
     Override this method to provide rendering behavior for custom value types.
@@ -157,6 +627,29 @@ class JsonRenderer
         noexcept(false); // may throw bad_alloc, length_error
 
   private:
+    /*
+    Render(builder) when RenderCache() is true and builder is tracking
+    changes.
+    */
+    std::string_view RenderWithCache(JsonBuilder const& builder);
+
+    /*
+    Returns false if the data of a value whose text would be copied from the
+    previous output has changed since the previous render (debug builds).
+    */
+    bool RenderCacheChangesRecorded(JsonBuilder const& builder) const noexcept;
+
+    /*
+    Marks the entry for the value at index and the entries for its
+    ancestors as dirty.
+    */
+    void RenderCacheMarkDirty(unsigned index) noexcept;
+
+    /*
+    Returns the render cache entry index of the value referenced by it.
+    */
+    unsigned RenderCacheIndex(iterator const& it) const noexcept;
+
     /*
     Renders any value and its children by dispatching to the appropriate
     subroutine.
@@ -169,10 +662,84 @@ class JsonRenderer
     itParent must be an array or object.
     Set showNames = true for object. Set showNames = false for array.
     Can be called with itParent == end() to render the root.
+    Nested arrays and objects are tracked in m_structures instead of by
+    recursion, so deeply-nested values do not consume call stack.
     Example output: {"ObjectName":{"ArrayName":[7]}}
     */
     void RenderStructure(iterator const& itParent, bool showNames);
 
+    /*
+    Renders the children of the frames on m_structures until the frame that
+    is on top at entry is done, then pops it. Does not render the closing
+    brace for that frame. If pParallel is not nullptr, renders the children
+    of *pParallel with RenderParallelChildren(*pParallel, cbParallel).
+    */
+    void RenderFrames(iterator const* pParallel, size_t cbParallel);
+
+    /*
+    Finds the structure that RenderStructure(itStart) should render with
+    multiple threads, and the estimated builder storage used by its
+    children. Returns false if it should not use multiple threads.
+    */
+    bool FindParallelStructure(
+        iterator const& itStart,
+        _Out_ iterator* pParallel,
+        _Out_ size_t* pcbParallel) const;
+
+    /*
+    Renders the children of itParent using up to m_threadCount threads,
+    followed by the closing brace. The opening brace must already be written.
+    cbChildren is the estimate returned by FindParallelStructure.
+    */
+    void RenderParallelChildren(
+        iterator const& itParent,
+        size_t cbChildren,
+        bool showNames);
+
+    /*
+    Copies the settings that affect the rendered text (formatting options,
+    name cache, and custom renderers) from other. Does not copy ThreadCount,
+    MaxDepth, RenderCache, or ChunkSize.
+    */
+    void CopySettings(JsonRenderer const& other) noexcept;
+
+    /*
+    Checks m_maxDepth, then pushes itParent's children onto m_structures.
+    Returns false (and pushes nothing) if itParent has no children.
+    */
+    bool PushStructure(iterator const& itParent, bool showNames);
+
+    /*
+    Renders a packed array value (e.g. JsonDoubleArray) as a JSON array. T is
+    the element type. Output is the same as for a JsonArray with the same
+    values. Example output: [1,2.5,3]
+    */
+    template<class T>
+    void RenderPackedArray(iterator const& it);
+
+    /*
+    Renders a value with a custom type using the function registered with
+    CustomRenderer if there is one, otherwise using RenderCustom.
+    */
+    void RenderCustomValue(iterator const& it);
+
+    /*
+    Returns the number of bytes that RenderValue(it) would write.
+    */
+    size_t MeasureValue(iterator const& it);
+
+    /*
+    Returns the number of bytes that RenderStructure(itParent, showNames)
+    would write.
+    */
+    size_t MeasureStructure(iterator const& itParent, bool showNames);
+
+    /*
+    Returns the number of bytes that RenderPackedArray<T>(it) would write.
+    */
+    template<class T>
+    size_t MeasurePackedArray(iterator const& it);
+
     /*
     Renders value as floating-point. Requires that cb be 4 or 8. Data will be
     interpreted as a little-endian float or double.
@@ -195,32 +762,82 @@ class JsonRenderer
     void RenderUInt(long long unsigned value);
 
     /*
-    Renders value as time. Requires that cb be 8. Data will be interpreted as
-    number of 100ns intervals since 1601-01-01T00:00:00Z.
+    Renders value as time using m_timeFormat. Requires that cb be 8. Data will
+    be interpreted as number of 100ns intervals since 1601-01-01T00:00:00Z.
     Example output: "2015-04-02T02:09:14.7927652Z".
     */
     void RenderTime(TimeStruct value);
 
     /*
-    Renders big-endian value as UUID. Compatible with uuid_t from libuuid.
+    Renders value as an exact decimal number.
+    Example output: 123.45
+    */
+    void RenderDecimal(DecimalStruct value);
+
+    /*
+    Renders big-endian value as UUID using m_uuidFormat. Compatible with uuid_t
+    from libuuid.
     Example output: "CD8D0A5E-6409-4B8E-9366-B815CEF0E35D".
     */
     void RenderUuid(_In_reads_(16) char unsigned const* value);
 
+    /*
+    Renders binary data as a Base64 string using m_binaryFormat.
+    Example output: "AQID"
+    */
+    void RenderBinary(_In_reads_bytes_(cb) void const* pb, unsigned cb);
+
     /*
     Renders value as a string. Escapes any control characters and adds quotes
     around the result. Example output: "String\n"
     */
     void RenderString(std::string_view value);
 
+    /*
+    Renders the name of object member it followed by ':' (and ' ' if
+    pretty-printing), using the name cache if enabled.
+    Example output: "Name":
+    */
+    void RenderName(iterator const& it);
+
+    /*
+    Renders value as a string without escaping. Requires that value contain
+    no characters that need to be escaped (e.g. JsonValue::IsEscapeFree()).
+    Example output: "String"
+    */
+    void RenderEscapeFreeString(std::string_view value);
+
+    /*
+    If rendering to a sink and the buffer holds at least m_chunkSize bytes,
+    passes full chunks to the sink and keeps the remainder in the buffer.
+    */
+    void FlushChunks();
+
+    /*
+    Returns m_newLine followed by m_indent m_indentChar characters, from
+    m_newLineIndent (rebuilt if it is too short).
+    */
+    std::string_view NewLineIndent();
+
     /*
     If pretty-printing is disabled, has no effect.
-    If pretty-printing is enabled, writes m_newLine followed by
-    (m_indent * m_indentSpaces) space characters.
+    If pretty-printing is enabled, writes m_newLine followed by m_indent
+    m_indentChar characters.
     */
     void RenderNewline();
 };
 
+/*
+Renders the given bytes as Base64 using the specified format, e.g. "AQID".
+pBuffer must have room for 4 * ((cb + 2) / 3) + 1 chars.
+Returns the number of characters written, not counting the nul-termination.
+*/
+JsonInternal::JSON_SIZE_T JsonRenderBase64(
+    _In_reads_bytes_(cb) void const* pb,
+    JsonInternal::JSON_SIZE_T cb,
+    JsonBinaryFormat format,
+    _Out_writes_z_(4 * ((cb + 2) / 3) + 1) char* pBuffer) noexcept;
+
 /*
 Renders the given value as an unsigned decimal integer, e.g. "123".
 Returns the number of characters written, not counting the nul-termination.
@@ -240,6 +857,32 @@ Returns the number of characters written, not counting the nul-termination.
 */
 unsigned JsonRenderFloat(double n, _Out_writes_z_(32) char* pBuffer) noexcept;
 
+/*
+Renders the given value as a signed floating-point using the specified format
+and precision, e.g. "-123.1", or "null" if the value is not finite. Trailing
+zeros after the decimal point are omitted. Precision greater than 17 is
+treated as 17. JsonFloatSignificant switches to exponent notation using the
+same rule as printf's %g, e.g. "1.23e+05".
+Digits match printf's %.*f or %.*g. Common cases use an integer-based
+formatter. JsonFloatFixed uses JsonFloatShortest for values of 1e12 or more
+when precision digits after the decimal point would not fit.
+Returns the number of characters written, not counting the nul-termination.
+*/
+unsigned JsonRenderFloat(
+    double n,
+    JsonFloatFormat format,
+    unsigned precision,
+    _Out_writes_z_(32) char* pBuffer) noexcept;
+
+/*
+Renders the given fixed-point value as an exact JSON number, keeping trailing
+zeros implied by the scale, e.g. "123.45", "-0.050", or "1.2e-10" when the
+value would otherwise need more than 5 leading zeros. Negative scales render
+with an exponent, e.g. "12e3".
+Returns the number of characters written, not counting the nul-termination.
+*/
+unsigned JsonRenderDecimal(DecimalStruct d, _Out_writes_z_(40) char* pBuffer) noexcept;
+
 /*
 Renders the string "true" or "false".
 Returns the number of characters written, not counting the nul-termination.
@@ -274,6 +917,28 @@ unsigned JsonRenderTime(
     std::chrono::system_clock::time_point t,
     _Out_writes_z_(29) char* pBuffer) noexcept;
 
+/*
+Renders the given date/time value using the specified format, e.g.
+"2015-04-02T02:09:14.792Z" (without quotes) or "1427940554792".
+Returns the number of characters written, not counting the nul-termination.
+(Returns at most 28.)
+*/
+unsigned JsonRenderTime(
+    TimeStruct t,
+    JsonTimeFormat format,
+    _Out_writes_z_(29) char* pBuffer) noexcept;
+
+/*
+Renders the given time_point value using the specified format, e.g.
+"2015-04-02T02:09:14.792Z" (without quotes) or "1427940554792".
+Returns the number of characters written, not counting the nul-termination.
+(Returns at most 28.)
+*/
+unsigned JsonRenderTime(
+    std::chrono::system_clock::time_point t,
+    JsonTimeFormat format,
+    _Out_writes_z_(29) char* pBuffer) noexcept;
+
 /*
 Renders the given big-endian uuid_t value as a string in uppercase without
 braces, e.g. "CD8D0A5E-6409-4B8E-9366-B815CEF0E35D".
@@ -282,6 +947,18 @@ Returns the number of characters written, not counting the nul-termination.
 */
 unsigned JsonRenderUuid(_In_reads_(16) char unsigned const* g, _Out_writes_z_(37) char* pBuffer) noexcept;
 
+/*
+Renders the given big-endian uuid_t value as a string using the specified
+format, e.g. "cd8d0a5e-6409-4b8e-9366-b815cef0e35d" or
+"CD8D0A5E64094B8E9366B815CEF0E35D".
+Returns the number of characters written, not counting the nul-termination.
+(Returns 36, or 32 for the compact formats.)
+*/
+unsigned JsonRenderUuid(
+    _In_reads_(16) char unsigned const* g,
+    JsonUuidFormat format,
+    _Out_writes_z_(37) char* pBuffer) noexcept;
+
 /*
 Renders the given big-endian uuid_t value as a string in uppercase with braces,
 e.g. "{CD8D0A5E-6409-4B8E-9366-B815CEF0E35D}".
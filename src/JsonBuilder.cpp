@@ -3,7 +3,10 @@
 
 #include <jsonbuilder/JsonBuilder.h>
 
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
 #include <cstring>
 
 #ifndef _Out_writes_to_
@@ -26,13 +29,38 @@ value.DataIndex = value.Index + DATA_OFFSET(value.cchName).
 #define IS_NORMAL_TYPE(type) ((type) < JsonHidden)
 #define IS_COMPOSITE_TYPE(type) (JsonArray <= (type))
 
-auto constexpr NameMax = 0xFFFFFFu;
+auto constexpr NameMax = 0x7FFFFFu;
 auto constexpr DataMax = 0xF0000000u;
+auto constexpr ChangeLogMax = 1024u;
+
+// Upper 32 bits of ChangeCount(). Each new sequence of changes gets a new
+// value so that a ChangeCount() from another builder never matches.
+static std::atomic<std::uint64_t> g_changeSequence{ 0 };
 
 auto constexpr TicksPerSecond = 10'000'000u;
 auto constexpr FileTime1970Ticks = 116444736000000000u;
 using ticks = std::chrono::duration<std::int64_t, std::ratio<1, TicksPerSecond>>;
 
+/*
+Returns true if none of the cb bytes at pb needs to be escaped in a JSON
+string, i.e. there are no control characters, quotes, or backslashes.
+*/
+static bool
+IsEscapeFree(
+    _In_reads_bytes_(cb) void const* pb,
+    unsigned cb) noexcept
+{
+    // No early exit, so that the compiler can vectorize the loop.
+    auto const pch = static_cast<unsigned char const*>(pb);
+    unsigned char escape = 0;
+    for (unsigned i = 0; i != cb; i += 1)
+    {
+        auto const ch = pch[i];
+        escape |= (ch < 0x20) | (ch == '"') | (ch == '\\');
+    }
+    return escape == 0;
+}
+
 static unsigned
 Utf16ToUtf8(
     _Out_writes_to_(cchSrc * 3, return) char unsigned* pchDest,
@@ -181,11 +209,6 @@ std::string_view JsonValue::Name() const noexcept
 }
 
 void const* JsonValue::Data(_Out_opt_ unsigned* pcbData) const noexcept
-{
-    return const_cast<JsonValue*>(this)->Data(pcbData);
-}
-
-void* JsonValue::Data(_Out_opt_ unsigned* pcbData) noexcept
 {
     assert(!IS_SPECIAL_TYPE(m_type));  // Can't call Data() on hidden,
     // object, or array values.
@@ -194,7 +217,22 @@ void* JsonValue::Data(_Out_opt_ unsigned* pcbData) noexcept
         *pcbData = m_cbData;
     }
 
-    return reinterpret_cast<StoragePod*>(this) + DATA_OFFSET(m_cchName);
+    return reinterpret_cast<StoragePod const*>(this) + DATA_OFFSET(m_cchName);
+}
+
+void* JsonValue::Data(_Out_opt_ unsigned* pcbData) noexcept
+{
+    if (m_type == JsonUtf8)
+    {
+        m_escapeFree = false; // Caller may write characters that need escaping.
+    }
+
+    return const_cast<void*>(static_cast<JsonValue const*>(this)->Data(pcbData));
+}
+
+bool JsonValue::IsEscapeFree() const noexcept
+{
+    return m_escapeFree;
 }
 
 unsigned JsonValue::DataSize() const noexcept
@@ -469,6 +507,12 @@ void JsonBuilder::Validator::Validate()
 
             // Now safe to dereference: m_cbData/m_lastChildIndex, Name.
 
+            if (pValue->m_escapeFree &&
+                !IsEscapeFree(pValue + 1, pValue->m_cchName))
+            {
+                JsonThrowInvalidArgument("JsonBuilder - corrupt data");
+            }
+
             if (IS_NORMAL_TYPE(pValue->m_type))
             {
                 if (pValue->m_cbData > DataMax)
@@ -483,6 +527,15 @@ void JsonBuilder::Validator::Validate()
                 {
                     UpdateMap(index + i, ValNone, ValTail);
                 }
+
+                // Now safe to dereference: Data.
+
+                if (pValue->m_escapeFree &&
+                    pValue->m_type == JsonUtf8 &&
+                    !IsEscapeFree(m_pStorage + index + nameEnd, pValue->m_cbData))
+                {
+                    JsonThrowInvalidArgument("JsonBuilder - corrupt data");
+                }
             }
         }
 
@@ -560,24 +613,42 @@ void JsonBuilder::Validator::UpdateMap(
 // JsonBuilder
 
 JsonBuilder::JsonBuilder() noexcept
+    : m_lastValueIndex(0)
+    , m_compactIntegers(false)
+    , m_trackChanges(false)
+    , m_changeBase(0)
 {
     return;
 }
 
 JsonBuilder::JsonBuilder(size_type cbInitialCapacity)
+    : m_lastValueIndex(0)
+    , m_compactIntegers(false)
+    , m_trackChanges(false)
+    , m_changeBase(0)
 {
     buffer_reserve(cbInitialCapacity);
 }
 
-JsonBuilder::JsonBuilder(JsonBuilder const& other) : m_storage(other.m_storage)
+JsonBuilder::JsonBuilder(JsonBuilder const& other)
+    : m_storage(other.m_storage)
+    , m_lastValueIndex(other.m_lastValueIndex)
+    , m_compactIntegers(other.m_compactIntegers)
+    , m_trackChanges(false)
+    , m_changeBase(0)
 {
     return;
 }
 
 JsonBuilder::JsonBuilder(JsonBuilder&& other) noexcept
     : m_storage(std::move(other.m_storage))
+    , m_lastValueIndex(other.m_lastValueIndex)
+    , m_compactIntegers(other.m_compactIntegers)
+    , m_trackChanges(false)
+    , m_changeBase(0)
 {
-    return;
+    other.m_lastValueIndex = 0;
+    other.ResetChanges();
 }
 
 JsonBuilder::JsonBuilder(
@@ -587,6 +658,10 @@ JsonBuilder::JsonBuilder(
     : m_storage(
           static_cast<JsonValue::StoragePod const*>(pbRawData),
           static_cast<unsigned>(cbRawData / StorageSize))
+    , m_lastValueIndex(0)
+    , m_compactIntegers(false)
+    , m_trackChanges(false)
+    , m_changeBase(0)
 {
     if (cbRawData % StorageSize != 0 ||
         cbRawData / StorageSize > StorageVec::max_size())
@@ -602,12 +677,20 @@ JsonBuilder::JsonBuilder(
 JsonBuilder& JsonBuilder::operator=(JsonBuilder const& other)
 {
     m_storage = other.m_storage;
+    m_lastValueIndex = other.m_lastValueIndex;
+    m_compactIntegers = other.m_compactIntegers;
+    ResetChanges();
     return *this;
 }
 
 JsonBuilder& JsonBuilder::operator=(JsonBuilder&& other) noexcept
 {
     m_storage = std::move(other.m_storage);
+    m_lastValueIndex = other.m_lastValueIndex;
+    m_compactIntegers = other.m_compactIntegers;
+    other.m_lastValueIndex = 0;
+    ResetChanges();
+    other.ResetChanges();
     return *this;
 }
 
@@ -619,6 +702,42 @@ void JsonBuilder::ValidateData() const
     }
 }
 
+bool JsonBuilder::CompactIntegers() const noexcept
+{
+    return m_compactIntegers;
+}
+
+void JsonBuilder::CompactIntegers(bool value) noexcept
+{
+    m_compactIntegers = value;
+}
+
+bool JsonBuilder::TrackChanges() const noexcept
+{
+    return m_trackChanges;
+}
+
+void JsonBuilder::TrackChanges(bool value)
+{
+    if (value && !m_trackChanges)
+    {
+        m_changes.reserve(ChangeLogMax); // Logging a change never allocates.
+        m_trackChanges = true;
+        ResetChanges();
+    }
+    else if (!value)
+    {
+        m_trackChanges = false;
+        m_changes.clear();
+        m_changeBase = 0;
+    }
+}
+
+JsonInternal::JSON_UINT64 JsonBuilder::ChangeCount() const noexcept
+{
+    return m_trackChanges ? m_changeBase + m_changes.size() : 0;
+}
+
 JsonBuilder::iterator JsonBuilder::begin() noexcept
 {
     return iterator(cbegin());
@@ -709,6 +828,8 @@ void JsonBuilder::buffer_reserve(size_type cbMinimumCapacity)
 void JsonBuilder::clear() noexcept
 {
     m_storage.clear();
+    m_lastValueIndex = 0;
+    ResetChanges();
 }
 
 JsonBuilder::iterator JsonBuilder::erase(const_iterator itValue) noexcept
@@ -721,9 +842,22 @@ JsonBuilder::iterator JsonBuilder::erase(const_iterator itValue) noexcept
     }
 
     GetValue(itValue.m_index).m_type = JsonHidden;
+    LogChange(itValue.m_index);
     return iterator(const_iterator(this, NextIndex(itValue.m_index)));
 }
 
+void* JsonBuilder::MutableData(
+    const_iterator const& itValue,
+    _Out_opt_ unsigned* pcbData) noexcept
+{
+    ValidateIterator(itValue);
+    AssertNotEnd(itValue.m_index);
+    assert(!IS_SPECIAL_TYPE(GetValue(itValue.m_index).m_type)); // Can't call
+    // MutableData() on object or array values.
+    LogChange(itValue.m_index);
+    return GetValue(itValue.m_index).Data(pcbData);
+}
+
 JsonBuilder::iterator
 JsonBuilder::erase(const_iterator itBegin, const_iterator itEnd) noexcept
 {
@@ -740,6 +874,7 @@ JsonBuilder::erase(const_iterator itBegin, const_iterator itEnd) noexcept
 
         auto& value = GetValue(index);
         value.m_type = JsonHidden;
+        LogChange(index);
         index = value.m_nextIndex;
     }
     return iterator(itEnd);
@@ -748,6 +883,17 @@ JsonBuilder::erase(const_iterator itBegin, const_iterator itEnd) noexcept
 void JsonBuilder::swap(JsonBuilder& other) noexcept
 {
     m_storage.swap(other.m_storage);
+
+    auto const lastValueIndex = m_lastValueIndex;
+    m_lastValueIndex = other.m_lastValueIndex;
+    other.m_lastValueIndex = lastValueIndex;
+
+    auto const compactIntegers = m_compactIntegers;
+    m_compactIntegers = other.m_compactIntegers;
+    other.m_compactIntegers = compactIntegers;
+
+    ResetChanges();
+    other.ResetChanges();
 }
 
 unsigned
@@ -881,12 +1027,14 @@ JsonBuilder::CreateRoot() noexcept(false)
     auto const pRootValue = reinterpret_cast<JsonValue*>(pStorage + RootIndex);
     pRootValue->m_nextIndex = SentinelIndex;
     pRootValue->m_cchName = 0u;
+    pRootValue->m_escapeFree = false;
     pRootValue->m_type = JsonObject;
     pRootValue->m_lastChildIndex = SentinelIndex;
 
     auto const pSentinel = reinterpret_cast<JsonValueBase*>(pStorage + SentinelIndex);
     pSentinel->m_nextIndex = RootIndex;
     pSentinel->m_cchName = 0;
+    pSentinel->m_escapeFree = false;
     pSentinel->m_type = JsonHidden;
 }
 
@@ -899,6 +1047,7 @@ JsonBuilder::NewValueInitImpl(
     unsigned cbDataHint)
     noexcept(false)  // may throw bad_alloc, length_error
 {
+    static_assert(DataHintMax == DataMax, "DataHintMax must match DataMax");
     ValidateIterator(itParent);
 
     if (cbDataHint < sizeof(void*) || cbDataHint > DataMax)
@@ -1015,6 +1164,7 @@ JsonBuilder::NewValueInit(
     auto const cchDest = cchSrc;
     memcpy(pchDest, pchSrc, cchSrc); // No conversion needed.
     pValue->m_cchName = cchDest;
+    pValue->m_escapeFree = IsEscapeFree(pchDest, cchDest);
     
     // Stash the old pointer for use by _newValueCommit.
     memcpy(reinterpret_cast<StoragePod*>(pValue) + DATA_OFFSET(cchDest),
@@ -1047,6 +1197,7 @@ JsonBuilder::NewValueInit(
     // Stash the name for use by _newValueCommit.
     auto const cchDest = Utf16ToUtf8(pchDest, pchSrc, cchSrc);
     pValue->m_cchName = cchDest;
+    pValue->m_escapeFree = IsEscapeFree(pchDest, cchDest);
 
     // Stash the old pointer for use by _newValueCommit.
     memcpy(reinterpret_cast<StoragePod*>(pValue) + DATA_OFFSET(cchDest),
@@ -1079,6 +1230,7 @@ JsonBuilder::NewValueInit(
     // Stash the name for use by _newValueCommit.
     auto const cchDest = Utf32ToUtf8(pchDest, pchSrc, cchSrc);
     pValue->m_cchName = cchDest;
+    pValue->m_escapeFree = IsEscapeFree(pchDest, cchDest);
 
     // Stash the old pointer for use by _newValueCommit.
     memcpy(reinterpret_cast<StoragePod*>(pValue) + DATA_OFFSET(cchDest),
@@ -1159,6 +1311,7 @@ JsonBuilder::_newValueCommit(
         auto pSentinel = reinterpret_cast<JsonValueBase*>(m_storage.data() + dataIndex);
         pSentinel->m_nextIndex = pRootValue->m_nextIndex;
         pSentinel->m_cchName = 0;
+        pSentinel->m_escapeFree = false;
         pSentinel->m_type = JsonHidden;
         pRootValue->m_nextIndex = dataIndex;
     }
@@ -1183,7 +1336,15 @@ JsonBuilder::_newValueCommit(
             }
 
             memcpy(m_storage.data() + dataIndex, pbData, cbData);
+            if (type == JsonUtf8 && pValue->m_escapeFree)
+            {
+                pValue->m_escapeFree = IsEscapeFree(m_storage.data() + dataIndex, cbData);
+            }
         }
+
+        // If pbData is null, the caller fills the data in using Data(), which
+        // clears m_escapeFree for JsonUtf8. Internal callers that write to
+        // storage directly must update m_escapeFree themselves.
     }
 
     // Find the right place in the linked list for the new node.
@@ -1212,9 +1373,177 @@ JsonBuilder::_newValueCommit(
     newValue.m_nextIndex = prevValue.m_nextIndex;
     prevValue.m_nextIndex = newIndex;
 
+    m_lastValueIndex = newIndex;
+    LogChange(parentIndex);
+
     return iterator(const_iterator(this, newIndex));
 }
 
+JsonBuilder::iterator
+JsonBuilder::EmplaceBegin(JsonType type, unsigned cbMaxData)
+    noexcept(false)  // may throw bad_alloc, length_error
+{
+    if (IS_SPECIAL_TYPE(type))
+    {
+        assert(!"JsonBuilder: emplace requires a non-composite type.");
+        std::terminate();
+    }
+
+    return _newValueCommit(type, cbMaxData, nullptr);
+}
+
+void
+JsonBuilder::EmplaceEnd(Index index, size_type cbActual) noexcept
+{
+    auto& value = GetValue(index);
+    if (cbActual > value.m_cbData)
+    {
+        assert(!"JsonBuilder: emplace fill returned more than cbMaxData.");
+        std::terminate();
+    }
+
+    // Shrink to fit actual data size. The value is the last one in storage.
+    auto const valueDataIndex = index + DATA_OFFSET(value.m_cchName);
+    assert(m_storage.size() == valueDataIndex + (value.m_cbData + StorageSize - 1) / StorageSize);
+    value.m_cbData = static_cast<unsigned>(cbActual); // Shrink
+    m_storage.resize(valueDataIndex + (value.m_cbData + StorageSize - 1) / StorageSize); // Shrink
+}
+
+void
+JsonBuilder::EmplaceAbort(Index index) noexcept
+{
+    // The value is already linked into its parent, so hide it (like erase)
+    // and release its payload. The value is the last one in storage.
+    auto& value = GetValue(index);
+    auto const valueDataIndex = index + DATA_OFFSET(value.m_cchName);
+    value.m_type = JsonHidden;
+    m_storage.resize(valueDataIndex); // Shrink
+    m_lastValueIndex = 0;
+}
+
+unsigned char*
+JsonBuilder::AppendToLastGrow(
+    unsigned cbMaxAppend,
+    void const*& pFragment)
+    noexcept(false)  // may throw bad_alloc, length_error
+{
+    auto const index = m_lastValueIndex;
+    if (index == 0 || !IS_NORMAL_TYPE(GetValue(index).m_type))
+    {
+        assert(!"JsonBuilder: append_to_last requires a non-erased, non-composite last value.");
+        std::terminate();
+    }
+
+    auto const cchName = GetValue(index).m_cchName;
+    auto const cbOld = GetValue(index).m_cbData;
+    if (cbMaxAppend > DataMax - cbOld)
+    {
+        JsonThrowLengthError("JsonBuilder - cbValue too large");
+    }
+
+    // The last value is always at the end of storage (though storage may be
+    // larger than the value's data if ReduceDataSize was used).
+    auto const valueDataIndex = index + DATA_OFFSET(cchName);
+    auto const newStorageSize = valueDataIndex + (cbOld + cbMaxAppend + StorageSize - 1) / StorageSize;
+    if (newStorageSize < valueDataIndex)
+    {
+        JsonThrowLengthError("JsonBuilder - too much data");
+    }
+
+    auto const pOldStorageData = m_storage.data();
+    auto const oldStorageSize = m_storage.size();
+    m_storage.resize(newStorageSize > oldStorageSize ? newStorageSize : oldStorageSize);
+
+    if (pOldStorageData != m_storage.data() && // We reallocated.
+        pOldStorageData != nullptr &&          // Wasn't empty.
+        pFragment >= static_cast<void const*>(pOldStorageData) &&
+        pFragment < static_cast<void const*>(pOldStorageData + oldStorageSize))
+    {
+        // Appending data from within the vector (e.g. the value's own data),
+        // and we just resized out from under them. Fix up the pointer.
+        pFragment = reinterpret_cast<char const*>(m_storage.data()) +
+            (static_cast<char const*>(pFragment) - reinterpret_cast<char const*>(pOldStorageData));
+    }
+
+    return reinterpret_cast<unsigned char*>(m_storage.data() + valueDataIndex) + cbOld;
+}
+
+JsonBuilder::iterator
+JsonBuilder::AppendToLastCommit(unsigned cbAppended) noexcept
+{
+    auto const index = m_lastValueIndex;
+    auto& value = GetValue(index);
+    auto const valueDataIndex = index + DATA_OFFSET(value.m_cchName);
+    if (value.m_type == JsonUtf8 && value.m_escapeFree)
+    {
+        value.m_escapeFree = IsEscapeFree(
+            reinterpret_cast<char const*>(m_storage.data() + valueDataIndex) + value.m_cbData,
+            cbAppended);
+    }
+    value.m_cbData += cbAppended;
+    m_storage.resize(valueDataIndex + (value.m_cbData + StorageSize - 1) / StorageSize); // Shrink
+    LogChange(index);
+    return iterator(const_iterator(this, index));
+}
+
+JsonBuilder::iterator
+JsonBuilder::AppendToLastImpl(
+    JsonInternal::JSON_SIZE_T cchFragment,
+    _In_reads_(cchFragment) char const* pchFragmentUtf8)
+    noexcept(false)  // may throw bad_alloc, length_error
+{
+    if (cchFragment > DataMax)
+    {
+        JsonThrowLengthError("JsonBuilder - cchData too large");
+    }
+
+    auto const cchSrc = static_cast<unsigned>(cchFragment);
+    void const* pSrc = pchFragmentUtf8;
+    auto const pDest = AppendToLastGrow(cchSrc, pSrc);
+    memmove(pDest, pSrc, cchSrc); // Source may overlap the value's own storage.
+    return AppendToLastCommit(cchSrc);
+}
+
+JsonBuilder::iterator
+JsonBuilder::AppendToLastImpl(
+    JsonInternal::JSON_SIZE_T cchFragment,
+    _In_reads_(cchFragment) char16_t const* pchFragmentUtf16)
+    noexcept(false)  // may throw bad_alloc, length_error
+{
+    auto constexpr WorstCaseMultiplier = 3u; // 1 UTF-16 code unit -> 3 UTF-8 code units.
+    if (cchFragment > DataMax / WorstCaseMultiplier)
+    {
+        JsonThrowLengthError("JsonBuilder - cchData too large");
+    }
+
+    // Reserve worst-case size, convert, then shrink to fit.
+    auto const cchSrc = static_cast<unsigned>(cchFragment);
+    void const* pSrc = pchFragmentUtf16;
+    auto const pDest = AppendToLastGrow(cchSrc * WorstCaseMultiplier, pSrc);
+    auto const cbDest = Utf16ToUtf8(pDest, static_cast<char16_t const*>(pSrc), cchSrc);
+    return AppendToLastCommit(cbDest);
+}
+
+JsonBuilder::iterator
+JsonBuilder::AppendToLastImpl(
+    JsonInternal::JSON_SIZE_T cchFragment,
+    _In_reads_(cchFragment) char32_t const* pchFragmentUtf32)
+    noexcept(false)  // may throw bad_alloc, length_error
+{
+    auto constexpr WorstCaseMultiplier = 4u; // 1 UTF-32 code unit -> 4 UTF-8 code units.
+    if (cchFragment > DataMax / WorstCaseMultiplier)
+    {
+        JsonThrowLengthError("JsonBuilder - cchData too large");
+    }
+
+    // Reserve worst-case size, convert, then shrink to fit.
+    auto const cchSrc = static_cast<unsigned>(cchFragment);
+    void const* pSrc = pchFragmentUtf32;
+    auto const pDest = AppendToLastGrow(cchSrc * WorstCaseMultiplier, pSrc);
+    auto const cbDest = Utf32ToUtf8(pDest, static_cast<char32_t const*>(pSrc), cchSrc);
+    return AppendToLastCommit(cbDest);
+}
+
 JsonBuilder::iterator
 JsonBuilder::_newValueCommitSbcsAsUtf8(
     JsonType type,
@@ -1237,6 +1566,10 @@ JsonBuilder::_newValueCommitSbcsAsUtf8(
     auto const valueDataIndex = valueIt.m_index + DATA_OFFSET(value.m_cchName);
     assert(m_storage.size() - valueDataIndex >= (cchSrc * WorstCaseMultiplier + StorageSize - 1u) / StorageSize);
     auto const cbDest = SbcsToUtf8(reinterpret_cast<unsigned char*>(m_storage.data() + valueDataIndex), sbcsData.data(), cchSrc, high128);
+    if (type == JsonUtf8 && value.m_escapeFree)
+    {
+        value.m_escapeFree = IsEscapeFree(m_storage.data() + valueDataIndex, cbDest);
+    }
 
     // Shrink to fit actual data size.
     value.m_cbData = cbDest; // Shrink
@@ -1281,6 +1614,10 @@ JsonBuilder::NewValueCommitUtfAsUtf8Impl(
     auto const valueDataIndex = valueIt.m_index + DATA_OFFSET(value.m_cchName);
     assert(m_storage.size() - valueDataIndex >= (cchSrc * WorstCaseMultiplier + StorageSize - 1u) / StorageSize);
     auto const cbDest = Utf16ToUtf8(reinterpret_cast<unsigned char*>(m_storage.data() + valueDataIndex), pchDataUtf16, cchSrc);
+    if (type == JsonUtf8 && value.m_escapeFree)
+    {
+        value.m_escapeFree = IsEscapeFree(m_storage.data() + valueDataIndex, cbDest);
+    }
 
     // Shrink to fit actual data size.
     value.m_cbData = cbDest; // Shrink
@@ -1311,6 +1648,10 @@ JsonBuilder::NewValueCommitUtfAsUtf8Impl(
     auto const valueDataIndex = valueIt.m_index + DATA_OFFSET(value.m_cchName);
     assert(m_storage.size() - valueDataIndex >= (cchSrc * WorstCaseMultiplier + StorageSize - 1u) / StorageSize);
     auto const cbDest = Utf32ToUtf8(reinterpret_cast<unsigned char*>(m_storage.data() + valueDataIndex), pchDataUtf32, cchSrc);
+    if (type == JsonUtf8 && value.m_escapeFree)
+    {
+        value.m_escapeFree = IsEscapeFree(m_storage.data() + valueDataIndex, cbDest);
+    }
 
     // Shrink to fit actual data size.
     value.m_cbData = cbDest; // Shrink
@@ -1368,6 +1709,36 @@ JsonValue& JsonBuilder::GetValue(Index index) noexcept
     return reinterpret_cast<JsonValue&>(m_storage[index]);
 }
 
+void JsonBuilder::LogChange(Index index) noexcept
+{
+    if (m_trackChanges)
+    {
+        if (m_changes.size() == ChangeLogMax)
+        {
+            // Full. Older changes are forgotten, so ForEachChangeSince fails
+            // for ChangeCount() values from before this point.
+            m_changeBase += m_changes.size();
+            m_changes.clear();
+            if ((m_changeBase & 0xFFFFFFFF) > 0xFFFFFFFF - ChangeLogMax)
+            {
+                ResetChanges();
+            }
+        }
+
+        assert(m_changes.size() < m_changes.capacity());
+        m_changes.push_back(index);
+    }
+}
+
+void JsonBuilder::ResetChanges() noexcept
+{
+    if (m_trackChanges)
+    {
+        m_changes.clear();
+        m_changeBase = (g_changeSequence.fetch_add(1, std::memory_order_relaxed) + 1) << 32;
+    }
+}
+
 JsonBuilder::Index JsonBuilder::FirstChild(Index index) const noexcept
 {
     auto cchName = reinterpret_cast<JsonValue const&>(m_storage[index]).m_cchName;
@@ -1409,6 +1780,177 @@ void swap(JsonBuilder& a, JsonBuilder& b) noexcept
     a.swap(b);
 }
 
+// JsonTemplate
+
+JsonTemplate::JsonTemplate(JsonBuilder const& prototype)
+    : m_prototype(prototype)
+{
+    return;
+}
+
+JsonTemplate::JsonTemplate(JsonBuilder&& prototype) noexcept
+    : m_prototype(std::move(prototype))
+{
+    return;
+}
+
+JsonBuilder const& JsonTemplate::prototype() const noexcept
+{
+    return m_prototype;
+}
+
+void JsonTemplate::instantiate(JsonBuilder& builder) const
+{
+    auto const& storage = m_prototype.m_storage;
+    builder.m_storage.clear(); // Keeps capacity.
+    builder.m_storage.append(storage.data(), storage.size());
+    builder.m_lastValueIndex = m_prototype.m_lastValueIndex;
+    builder.ResetChanges();
+}
+
+JsonBuilder JsonTemplate::instantiate() const
+{
+    return JsonBuilder(m_prototype);
+}
+
+JsonBuilder::iterator JsonTemplate::at(JsonBuilder& builder, Slot slot) const noexcept
+{
+    return JsonBuilder::iterator(at(static_cast<JsonBuilder const&>(builder), slot));
+}
+
+JsonBuilder::const_iterator JsonTemplate::at(JsonBuilder const& builder, Slot slot) const noexcept
+{
+    if (slot.m_index == 0 ||
+        slot.m_index >= m_prototype.m_storage.size() ||
+        slot.m_index >= builder.m_storage.size())
+    {
+        assert(!"JsonBuilder: invalid JsonTemplate slot.");
+        std::terminate();
+    }
+
+    return JsonBuilder::const_iterator(&builder, slot.m_index);
+}
+
+void JsonTemplate::store(
+    JsonBuilder& builder,
+    Slot slot,
+    _In_reads_bytes_(cbData) void const* pbData,
+    unsigned cbData) const noexcept
+{
+    auto& value = *at(builder, slot);
+    if (IS_SPECIAL_TYPE(value.Type()) || value.DataSize() != cbData)
+    {
+        assert(!"JsonBuilder: JsonTemplate::store requires a non-composite value of the same size.");
+        std::terminate();
+    }
+
+    memcpy(builder.MutableData(at(builder, slot)), pbData, cbData);
+}
+
+void JsonTemplate::StoreInteger(
+    JsonBuilder& builder,
+    Slot slot,
+    _In_reads_bytes_(cbData) void const* pbData,
+    unsigned cbData,
+    bool isSigned) const noexcept
+{
+    auto& value = *at(builder, slot);
+    auto const type = value.Type();
+    auto const cbSlot = value.DataSize();
+    if ((type != JsonInt && type != JsonUInt) ||
+        (cbSlot == cbData && isSigned == (type == JsonInt)))
+    {
+        store(builder, slot, pbData, cbData);
+        return;
+    }
+
+    // Widen the input to 64 bits.
+    uint64_t n64;
+    switch (cbData)
+    {
+    case 1:
+        n64 = isSigned
+            ? static_cast<uint64_t>(*static_cast<int8_t const*>(pbData))
+            : *static_cast<uint8_t const*>(pbData);
+        break;
+    case 2:
+        n64 = isSigned
+            ? static_cast<uint64_t>(*static_cast<int16_t const*>(pbData))
+            : *static_cast<uint16_t const*>(pbData);
+        break;
+    case 4:
+        n64 = isSigned
+            ? static_cast<uint64_t>(*static_cast<int32_t const*>(pbData))
+            : *static_cast<uint32_t const*>(pbData);
+        break;
+    default:
+        memcpy(&n64, pbData, sizeof(n64));
+        break;
+    }
+
+    bool const negative = isSigned && static_cast<int64_t>(n64) < 0;
+    bool fits;
+    switch (cbSlot)
+    {
+    case 1:
+        fits = type == JsonInt
+            ? (negative ? static_cast<int64_t>(n64) >= INT8_MIN : n64 <= INT8_MAX)
+            : !negative && n64 <= UINT8_MAX;
+        break;
+    case 2:
+        fits = type == JsonInt
+            ? (negative ? static_cast<int64_t>(n64) >= INT16_MIN : n64 <= INT16_MAX)
+            : !negative && n64 <= UINT16_MAX;
+        break;
+    case 4:
+        fits = type == JsonInt
+            ? (negative ? static_cast<int64_t>(n64) >= INT32_MIN : n64 <= INT32_MAX)
+            : !negative && n64 <= UINT32_MAX;
+        break;
+    case 8:
+        fits = type == JsonInt
+            ? (negative || n64 <= INT64_MAX)
+            : !negative;
+        break;
+    default:
+        fits = false;
+        break;
+    }
+
+    if (!fits)
+    {
+        assert(!"JsonBuilder: JsonTemplate::store value does not fit in the slot's type and width.");
+        std::terminate();
+    }
+
+    // Two's complement truncation to the slot's width.
+    auto const pData = builder.MutableData(at(builder, slot));
+    switch (cbSlot)
+    {
+    case 1:
+    {
+        auto const n = static_cast<uint8_t>(n64);
+        memcpy(pData, &n, sizeof(n));
+        break;
+    }
+    case 2:
+    {
+        auto const n = static_cast<uint16_t>(n64);
+        memcpy(pData, &n, sizeof(n));
+        break;
+    }
+    case 4:
+    {
+        auto const n = static_cast<uint32_t>(n64);
+        memcpy(pData, &n, sizeof(n));
+        break;
+    }
+    default:
+        memcpy(pData, &n64, sizeof(n64));
+        break;
+    }
+}
+
 // JsonImplementType
 
 /*
@@ -1431,8 +1973,76 @@ and i32) aren't perfectly optimal... But they're probably close enough.
         return static_cast<DataType>(GetUnchecked##ValueType(value)); \
     }
 
+/*
+AddValueCommitJsonUInt, AddValueCommitJsonInt: if builder.CompactIntegers()
+is set, commit the smallest width (1, 2, 4, or 8 bytes) that holds data.
+Otherwise commit sizeof(data) bytes.
+*/
+template<class T>
+static JsonIterator AddValueCommitJsonUInt(JsonBuilder& builder, T data)
+{
+    auto const n64 = static_cast<uint64_t>(data);
+    if (sizeof(data) > 1 && builder.CompactIntegers())
+    {
+        if (n64 <= UINT8_MAX)
+        {
+            auto const n = static_cast<uint8_t>(n64);
+            return builder._newValueCommit(JsonUInt, sizeof(n), &n);
+        }
+        else if (n64 <= UINT16_MAX)
+        {
+            auto const n = static_cast<uint16_t>(n64);
+            return builder._newValueCommit(JsonUInt, sizeof(n), &n);
+        }
+        else if (n64 <= UINT32_MAX)
+        {
+            auto const n = static_cast<uint32_t>(n64);
+            return builder._newValueCommit(JsonUInt, sizeof(n), &n);
+        }
+    }
+
+    return builder._newValueCommit(JsonUInt, sizeof(data), &data);
+}
+
+template<class T>
+static JsonIterator AddValueCommitJsonInt(JsonBuilder& builder, T data)
+{
+    auto const n64 = static_cast<int64_t>(data);
+    if (sizeof(data) > 1 && builder.CompactIntegers())
+    {
+        if (INT8_MIN <= n64 && n64 <= INT8_MAX)
+        {
+            auto const n = static_cast<int8_t>(n64);
+            return builder._newValueCommit(JsonInt, sizeof(n), &n);
+        }
+        else if (INT16_MIN <= n64 && n64 <= INT16_MAX)
+        {
+            auto const n = static_cast<int16_t>(n64);
+            return builder._newValueCommit(JsonInt, sizeof(n), &n);
+        }
+        else if (INT32_MIN <= n64 && n64 <= INT32_MAX)
+        {
+            auto const n = static_cast<int32_t>(n64);
+            return builder._newValueCommit(JsonInt, sizeof(n), &n);
+        }
+    }
+
+    return builder._newValueCommit(JsonInt, sizeof(data), &data);
+}
+
+template<class T>
+static JsonIterator AddValueCommitJsonFloat(JsonBuilder& builder, T data)
+{
+    return builder._newValueCommit(JsonFloat, sizeof(data), &data);
+}
+
 #define IMPLEMENT_JsonImplementType(DataType, ValueType, InRef)   \
-    IMPLEMENT_AddValue(DataType, sizeof(data), &data, ValueType, InRef); \
+    JsonIterator JsonImplementType<DataType>::AddValueCommit(     \
+        JsonBuilder& builder,                                     \
+        DataType InRef data)                                      \
+    {                                                             \
+        return AddValueCommit##ValueType(builder, data);          \
+    }                                                             \
     IMPLEMENT_GetUnchecked(DataType, ValueType);                  \
                                                                   \
     bool JsonImplementType<DataType>::ConvertTo(                  \
@@ -1561,7 +2171,13 @@ static uint64_t GetUncheckedJsonUInt(JsonValue const& value)
     return result;
 }
 
-IMPLEMENT_AddValue(unsigned long long, sizeof(data), &data, JsonUInt, );
+JsonIterator JsonImplementType<unsigned long long>::AddValueCommit(
+    JsonBuilder& builder,
+    unsigned long long data)
+{
+    return AddValueCommitJsonUInt(builder, data);
+}
+
 IMPLEMENT_GetUnchecked(unsigned long long, JsonUInt);
 
 template<class T>
@@ -1665,7 +2281,13 @@ static int64_t GetUncheckedJsonInt(JsonValue const& value)
     return result;
 }
 
-IMPLEMENT_AddValue(signed long long, sizeof(data), &data, JsonInt, );
+JsonIterator JsonImplementType<signed long long>::AddValueCommit(
+    JsonBuilder& builder,
+    signed long long data)
+{
+    return AddValueCommitJsonInt(builder, data);
+}
+
 IMPLEMENT_GetUnchecked(signed long long, JsonInt);
 
 template<class T>
@@ -1719,6 +2341,41 @@ double JsonImplementType<double>::GetUnchecked(JsonValue const& value) noexcept
     return result;
 }
 
+static double DecimalToDouble(DecimalStruct const& data) noexcept
+{
+    static double const Pow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    static long long signed const ExactMantissaMax = 1ll << 53;
+
+    auto const mantissa = data.Mantissa();
+    auto const scale = data.Scale;
+    double result;
+
+    if (mantissa == 0)
+    {
+        result = 0.0;
+    }
+    else if (-ExactMantissaMax <= mantissa && mantissa <= ExactMantissaMax &&
+        -22 <= scale && scale <= 22)
+    {
+        // Both operands are exactly representable, so the single multiply or
+        // divide gives the correctly-rounded result.
+        auto const m = static_cast<double>(mantissa);
+        result = scale >= 0 ? m / Pow10[scale] : m * Pow10[-scale];
+    }
+    else
+    {
+        // Rare: may differ from the correctly-rounded result in the last bit.
+        result = static_cast<double>(
+            static_cast<long double>(mantissa) *
+            std::pow(10.0L, -static_cast<long double>(scale)));
+    }
+
+    return result;
+}
+
 bool JsonImplementType<double>::ConvertTo(
     JsonValue const& value,
     double& result) noexcept
@@ -1744,6 +2401,12 @@ bool JsonImplementType<double>::ConvertTo(
         success = true;
         break;
 
+    case JsonDecimal:
+        result = DecimalToDouble(
+            JsonImplementType<DecimalStruct>::GetUnchecked(value));
+        success = true;
+        break;
+
     default:
         result = 0.0;
         success = false;
@@ -1989,6 +2652,57 @@ JsonImplementType<TimeStruct>::GetUnchecked(JsonValue const& jsonValue) noexcept
         TimeStruct();
 }
 
+// JsonDecimal
+
+IMPLEMENT_AddValue(DecimalStruct, sizeof(DecimalStruct), &data, JsonDecimal, );
+
+bool JsonImplementType<DecimalStruct>::ConvertTo(
+    JsonValue const& jsonValue,
+    DecimalStruct& value) noexcept
+{
+    bool success;
+
+    switch (jsonValue.Type())
+    {
+    case JsonDecimal:
+        value = GetUnchecked(jsonValue);
+        success = true;
+        break;
+
+    case JsonInt:
+        value = DecimalStruct::FromValue(
+            JsonImplementType<signed long long>::GetUnchecked(jsonValue), 0);
+        success = true;
+        break;
+
+    case JsonUInt:
+    {
+        auto const n = JsonImplementType<unsigned long long>::GetUnchecked(jsonValue);
+        success = n <= static_cast<unsigned long long>(INT64_MAX);
+        value = DecimalStruct::FromValue(success ? static_cast<long long signed>(n) : 0, 0);
+        break;
+    }
+
+    default:
+        value = DecimalStruct();
+        success = false;
+        break;
+    }
+
+    return success;
+}
+
+DecimalStruct
+JsonImplementType<DecimalStruct>::GetUnchecked(JsonValue const& jsonValue) noexcept
+{
+    assert(jsonValue.Type() == JsonDecimal);
+    assert(jsonValue.DataSize() == sizeof(DecimalStruct));
+
+    return jsonValue.DataSize() == sizeof(DecimalStruct) ?
+        *static_cast<const DecimalStruct*>(jsonValue.Data()) :
+        DecimalStruct();
+}
+
 // JsonUuid
 
 IMPLEMENT_AddValue(UuidStruct, sizeof(UuidStruct), &data, JsonUuid, const&);
@@ -3,20 +3,17 @@
 
 #include <jsonbuilder/JsonRenderer.h>
 
-#ifdef _WIN32
-#include <windows.h>
-#else
-#define __USE_TIME_BITS64
-#include <time.h>
-static_assert(sizeof(time_t) == 8, "time_t must be 64 bits");
-#endif
-
 #include <cassert>
 #include <cmath>
 #include <cstdint>
 #include <cstring>
 #include <charconv>
+#include <exception>
 #include <limits>
+#include <memory>
+#include <ostream>
+#include <thread>
+#include <vector>
 
 #ifdef __cpp_lib_to_chars
 #define FORMAT_DOUBLE_USING_TO_CHARS 1
@@ -28,6 +25,22 @@ static_assert(sizeof(time_t) == 8, "time_t must be 64 bits");
 #include <cstdio>
 #endif
 
+#if defined(__SSSE3__) || defined(__AVX__)
+#define BASE64_USING_SSSE3 1
+#include <tmmintrin.h>
+#else
+#define BASE64_USING_SSSE3 0
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HEX_USING_SSE2 1
+#include <emmintrin.h>
+#else
+#define HEX_USING_SSE2 0
+#endif
+
+#define ESCAPE_USING_SSE2 HEX_USING_SSE2
+
 #ifndef _Out_writes_
 #define _Out_writes_(c)
 #endif
@@ -85,6 +98,123 @@ static void FormatUint(unsigned n, _Out_writes_(cch) char* pch, unsigned cch)
     } while (cch != 0);
 }
 
+/*
+Base64 alphabets. Index 0 = standard, 1 = URL-safe.
+*/
+static char const Base64Chars[2][65] = {
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/",
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_",
+};
+
+#if BASE64_USING_SSSE3
+
+/*
+Encodes 12-byte groups of input 16 output chars at a time. Reads 16 bytes of
+input per group, so it stops while at least 4 bytes of input remain.
+Returns the number of input bytes consumed (a multiple of 3).
+Algorithm from W. Mula and D. Lemire, "Faster Base64 Encoding and Decoding
+using AVX2 Instructions".
+*/
+static size_t Base64EncodeSsse3(
+    _In_reads_bytes_(cb) unsigned char const* pb,
+    size_t cb,
+    bool urlSafe,
+    _Out_writes_(cb / 3 * 4) char* pch) noexcept
+{
+    auto const shuffleInput = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    auto const maskHigh = _mm_set1_epi32(0x0fc0fc00);
+    auto const mulHigh = _mm_set1_epi32(0x04000040);
+    auto const maskLow = _mm_set1_epi32(0x003f03f0);
+    auto const mulLow = _mm_set1_epi32(0x01000010);
+    auto const fiftyOne = _mm_set1_epi8(51);
+    auto const twentySix = _mm_set1_epi8(26);
+    auto const thirteen = _mm_set1_epi8(13);
+    auto const shiftLut = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        static_cast<char>((urlSafe ? '-' : '+') - 62),
+        static_cast<char>((urlSafe ? '_' : '/') - 63),
+        'A', 0, 0);
+
+    size_t i = 0;
+    for (; cb - i >= 16; i += 12, pch += 16)
+    {
+        // Split each 3 input bytes into 4 6-bit indexes.
+        auto in = _mm_loadu_si128(reinterpret_cast<__m128i const*>(pb + i));
+        in = _mm_shuffle_epi8(in, shuffleInput);
+        auto const indexesHigh = _mm_mulhi_epu16(_mm_and_si128(in, maskHigh), mulHigh);
+        auto const indexesLow = _mm_mullo_epi16(_mm_and_si128(in, maskLow), mulLow);
+        auto const indexes = _mm_or_si128(indexesHigh, indexesLow);
+
+        // Map indexes to chars: compute per-range offset, then add.
+        auto range = _mm_subs_epu8(indexes, fiftyOne);
+        range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(twentySix, indexes), thirteen));
+        auto const out = _mm_add_epi8(_mm_shuffle_epi8(shiftLut, range), indexes);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pch), out);
+    }
+
+    return i;
+}
+
+#endif // BASE64_USING_SSSE3
+
+JsonInternal::JSON_SIZE_T JsonRenderBase64(
+    _In_reads_bytes_(cb) void const* pb,
+    JsonInternal::JSON_SIZE_T cb,
+    JsonBinaryFormat format,
+    _Out_writes_z_(4 * ((cb + 2) / 3) + 1) char* pBuffer) noexcept
+{
+    bool const urlSafe = format == JsonBinaryBase64Url;
+    auto const chars = Base64Chars[urlSafe];
+    auto const pbIn = static_cast<unsigned char const*>(pb);
+    auto pch = pBuffer;
+
+#if BASE64_USING_SSSE3
+    size_t i = Base64EncodeSsse3(pbIn, cb, urlSafe, pch);
+    pch += i / 3 * 4;
+#else
+    size_t i = 0;
+#endif
+
+    for (; cb - i >= 3; i += 3, pch += 4)
+    {
+        uint32_t const n = (pbIn[i] << 16) | (pbIn[i + 1] << 8) | pbIn[i + 2];
+        pch[0] = chars[n >> 18];
+        pch[1] = chars[(n >> 12) & 0x3f];
+        pch[2] = chars[(n >> 6) & 0x3f];
+        pch[3] = chars[n & 0x3f];
+    }
+
+    switch (cb - i)
+    {
+    case 1: {
+        uint32_t const n = pbIn[i] << 16;
+        *pch++ = chars[n >> 18];
+        *pch++ = chars[(n >> 12) & 0x3f];
+        if (!urlSafe)
+        {
+            *pch++ = '=';
+            *pch++ = '=';
+        }
+        break;
+    }
+    case 2: {
+        uint32_t const n = (pbIn[i] << 16) | (pbIn[i + 1] << 8);
+        *pch++ = chars[n >> 18];
+        *pch++ = chars[(n >> 12) & 0x3f];
+        *pch++ = chars[(n >> 6) & 0x3f];
+        if (!urlSafe)
+        {
+            *pch++ = '=';
+        }
+        break;
+    }
+    }
+
+    *pch = 0;
+    return static_cast<JsonInternal::JSON_SIZE_T>(pch - pBuffer);
+}
+
 template<unsigned CB, class N>
 static unsigned JsonRenderXInt(N const& n, _Out_writes_z_(CB) char* pBuffer)
 {
@@ -150,218 +280,1260 @@ unsigned JsonRenderFloat(double n, _Out_writes_z_(32) char* pBuffer) noexcept
     return cch;
 }
 
-unsigned JsonRenderBool(bool b, _Out_writes_z_(6) char* pBuffer) noexcept
+// Powers of 10 that are exactly representable as double.
+static double const Pow10Exact[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Integers below this are exact in double, and so is scaled - nearbyint(scaled).
+auto constexpr DoubleExactIntegerLimit = 9007199254740992.0; // 2^53
+
+/*
+Returns value * 10^exp10 rounded to the nearest integer (ties to even) as if
+computed exactly. Requires |exp10| <= 22 and a result below 2^53.
+*/
+static double RoundScaledPow10(double value, int exp10) noexcept
 {
-    return b ? MemCpyFromLiteral(pBuffer, "true") : MemCpyFromLiteral(pBuffer, "false");
+    auto const pow10 = Pow10Exact[exp10 < 0 ? -exp10 : exp10];
+    auto const scaled = exp10 < 0 ? value / pow10 : value * pow10;
+    auto rounded = std::nearbyint(scaled);
+    auto const frac = scaled - rounded;
+    if (frac == 0.5 || frac == -0.5)
+    {
+        // The multiply/divide may have rounded onto a tie. The exact remainder
+        // (via fma) tells which side of the tie the true result lies on.
+        auto const remainder = exp10 < 0
+            ? std::fma(-scaled, pow10, value)
+            : std::fma(value, pow10, -scaled);
+        if (frac > 0 && remainder > 0)
+        {
+            rounded += 1;
+        }
+        else if (frac < 0 && remainder < 0)
+        {
+            rounded -= 1;
+        }
+    }
+
+    return rounded;
 }
 
-unsigned JsonRenderNull(_Out_writes_z_(5) char* pBuffer) noexcept
+/*
+Writes [-]digits with a decimal point before the last cFrac digits, e.g.
+"12.5" or "0.0125". Trailing fractional zeros are dropped.
+*/
+static unsigned
+FormatFixedDigits(bool negative, uint64_t mantissa, unsigned cFrac, _Out_writes_(32) char* pBuffer) noexcept
 {
-    return MemCpyFromLiteral(pBuffer, "null");
+    char* pch = pBuffer;
+    if (mantissa == 0)
+    {
+        *pch++ = '0';
+        return static_cast<unsigned>(pch - pBuffer);
+    }
+
+    char digits[20];
+    auto cDigits = static_cast<unsigned>(
+        std::to_chars(digits, digits + sizeof(digits), mantissa).ptr - digits);
+    for (; cFrac != 0 && digits[cDigits - 1] == '0'; cFrac -= 1)
+    {
+        cDigits -= 1;
+    }
+
+    if (negative)
+    {
+        *pch++ = '-';
+    }
+
+    if (cDigits > cFrac)
+    {
+        auto const cInteger = cDigits - cFrac;
+        memcpy(pch, digits, cInteger);
+        pch += cInteger;
+        if (cFrac != 0)
+        {
+            *pch++ = '.';
+            memcpy(pch, digits + cInteger, cFrac);
+            pch += cFrac;
+        }
+    }
+    else
+    {
+        auto const cZeros = cFrac - cDigits;
+        *pch++ = '0';
+        *pch++ = '.';
+        memset(pch, '0', cZeros);
+        pch += cZeros;
+        memcpy(pch, digits, cDigits);
+        pch += cDigits;
+    }
+
+    return static_cast<unsigned>(pch - pBuffer);
 }
 
+/*
+Writes [-]d.ddde+XX, i.e. the mantissa digits with a decimal point after the
+first digit. Trailing zeros are dropped.
+*/
 static unsigned
-RenderFileTime(uint64_t ft, _Out_writes_z_(29) char* pBuffer) noexcept
+FormatExponentDigits(bool negative, uint64_t mantissa, int exp10, _Out_writes_(32) char* pBuffer) noexcept
 {
-    // Only attempt to render years between 1601 and 9999.
-    if (ft < FileTime10000Ticks)
+    char* pch = pBuffer;
+    char digits[20] = {};
+    auto cDigits = static_cast<unsigned>(
+        std::to_chars(digits, digits + sizeof(digits), mantissa).ptr - digits);
+    while (cDigits > 1 && digits[cDigits - 1] == '0')
     {
-        auto const subsecondTicks = static_cast<unsigned>(ft % TicksPerSecond);
+        cDigits -= 1;
+    }
+
+    if (negative)
+    {
+        *pch++ = '-';
+    }
+
+    *pch++ = digits[0];
+    if (cDigits > 1)
+    {
+        *pch++ = '.';
+        memcpy(pch, digits + 1, cDigits - 1);
+        pch += cDigits - 1;
+    }
+
+    *pch++ = 'e';
+    *pch++ = exp10 < 0 ? '-' : '+';
+    auto const exp10Abs = static_cast<unsigned>(exp10 < 0 ? -exp10 : exp10);
+    if (exp10Abs < 10)
+    {
+        *pch++ = '0';
+    }
+    pch = std::to_chars(pch, pch + 3, exp10Abs).ptr;
+
+    return static_cast<unsigned>(pch - pBuffer);
+}
+
+/*
+Formats like printf's %.*f (with trailing fractional zeros dropped) or %.*g.
+Exact, but slower than the integer paths. Used only where those could lose
+digits. For fixed, requires |n| < 1e12 so the output fits.
+*/
+static unsigned
+FormatFloatPrecise(double n, bool fixed, unsigned precision, _Out_writes_z_(32) char* pBuffer) noexcept
+{
+    unsigned cch;
+
+#if FORMAT_DOUBLE_USING_TO_CHARS
+
+    auto const result = std::to_chars(
+        pBuffer,
+        pBuffer + 31,
+        n,
+        fixed ? std::chars_format::fixed : std::chars_format::general,
+        static_cast<int>(precision));
+    assert(result.ec == std::errc());
+    cch = static_cast<unsigned>(result.ptr - pBuffer);
+
+#else // FORMAT_DOUBLE_USING_TO_CHARS
+
+    cch = static_cast<unsigned>(std::snprintf(
+        pBuffer, 32, fixed ? "%.*f" : "%.*g", static_cast<int>(precision), n));
+    assert(cch < 32);
 
-#ifdef _WIN32
-        SYSTEMTIME st;
-        if (!FileTimeToSystemTime(reinterpret_cast<FILETIME const*>(&ft), &st))
+#endif // FORMAT_DOUBLE_USING_TO_CHARS
+
+    if (fixed && memchr(pBuffer, '.', cch))
+    {
+        while (pBuffer[cch - 1] == '0')
         {
-            assert(false); // Unexpected - should succeed for all values 1601..32000.
-            goto NotOk;
+            cch -= 1;
         }
 
-        auto const year = st.wYear;
-        auto const month = st.wMonth;
-        auto const day = st.wDay;
-        auto const hour = st.wHour;
-        auto const minute = st.wMinute;
-        auto const second = st.wSecond;
-#else
-        auto const seconds1601 = ft / TicksPerSecond;
-        time_t const seconds1970 = static_cast<int64_t>(seconds1601) - (FileTime1970Ticks / TicksPerSecond);
+        if (pBuffer[cch - 1] == '.')
+        {
+            cch -= 1;
+        }
 
-        tm timeStruct;
-        if (0 == gmtime_r(&seconds1970, &timeStruct))
+        if (cch == 2 && pBuffer[0] == '-' && pBuffer[1] == '0')
         {
-            goto NotOk;
+            pBuffer[0] = '0';
+            cch = 1;
         }
+    }
 
-        auto const year = static_cast<unsigned>(timeStruct.tm_year + 1900);
-        auto const month = static_cast<unsigned>(timeStruct.tm_mon + 1);
-        auto const day = static_cast<unsigned>(timeStruct.tm_mday);
-        auto const hour = static_cast<unsigned>(timeStruct.tm_hour);
-        auto const minute = static_cast<unsigned>(timeStruct.tm_min);
-        auto const second = static_cast<unsigned>(timeStruct.tm_sec);
-#endif
+    pBuffer[cch] = 0;
+    return cch;
+}
+
+unsigned JsonRenderFloat(
+    double n,
+    JsonFloatFormat format,
+    unsigned precision,
+    _Out_writes_z_(32) char* pBuffer) noexcept
+{
+    auto constexpr PrecisionMax = 17u;
+    unsigned cch;
+
+    if (precision > PrecisionMax)
+    {
+        precision = PrecisionMax;
+    }
+
+    auto const negative = std::signbit(n);
+    auto const a = std::fabs(n);
 
-        FormatUint(year, pBuffer + 0, 4);
-        pBuffer[4] = '-';
-        FormatUint(month, pBuffer + 5, 2);
-        pBuffer[7] = '-';
-        FormatUint(day, pBuffer + 8, 2);
-        pBuffer[10] = 'T';
-        FormatUint(hour, pBuffer + 11, 2);
-        pBuffer[13] = ':';
-        FormatUint(minute, pBuffer + 14, 2);
-        pBuffer[16] = ':';
-        FormatUint(second, pBuffer + 17, 2);
-        pBuffer[19] = '.';
-        FormatUint(subsecondTicks, pBuffer + 20, 7);
-        pBuffer[27] = 'Z';
-        pBuffer[28] = 0;
+    if (!std::isfinite(n) || format == JsonFloatShortest)
+    {
+        cch = JsonRenderFloat(n, pBuffer);
+    }
+    else if (format == JsonFloatFixed)
+    {
+        if (a * Pow10Exact[precision] < DoubleExactIntegerLimit)
+        {
+            auto const mantissa = static_cast<uint64_t>(RoundScaledPow10(a, static_cast<int>(precision)));
+            cch = FormatFixedDigits(negative, mantissa, precision, pBuffer);
+            pBuffer[cch] = 0;
+        }
+        else if (a < 1e12)
+        {
+            cch = FormatFloatPrecise(n, true, precision, pBuffer);
+        }
+        else
+        {
+            // Shortest output has at most precision fractional digits here.
+            cch = JsonRenderFloat(n, pBuffer);
+        }
     }
     else
     {
-    NotOk:
+        if (precision == 0)
+        {
+            precision = 1;
+        }
+
+        // Scale so that the significant digits form an integer. The estimate
+        // of the decimal exponent from log10 may be off by one; fix it up if
+        // the rounded digits are outside [10^(precision-1), 10^precision).
+        auto const p = static_cast<int>(precision);
+        auto const limit = Pow10Exact[precision];
+        auto exp10 = a == 0 ? 0 : static_cast<int>(std::floor(std::log10(a)));
+        if (precision <= 15 && -21 <= p - 1 - exp10 && p - 1 - exp10 <= 21)
+        {
+            auto scaled = RoundScaledPow10(a, p - 1 - exp10);
+            if (scaled != 0 && scaled < limit / 10)
+            {
+                exp10 -= 1;
+                scaled = RoundScaledPow10(a, p - 1 - exp10);
+            }
 
-        // Unable to print a nice date-time. Print the raw FILETIME instead,
-        // something like "FILETIME(0x0000000000000000)" (still 28 chars).
-        auto p = pBuffer;
-        p += MemCpyFromLiteral(p, "FILETIME(0x");
+            if (scaled >= limit)
+            {
+                exp10 += 1;
+                scaled = RoundScaledPow10(a, p - 1 - exp10);
+            }
 
-        auto const pData = reinterpret_cast<unsigned char const*>(&ft);
-        for (unsigned i = 0; i != 8; i += 1)
+            auto const mantissa = static_cast<uint64_t>(scaled);
+            cch = exp10 < -4 || exp10 >= p
+                ? FormatExponentDigits(negative, mantissa, exp10, pBuffer)
+                : FormatFixedDigits(negative, mantissa, static_cast<unsigned>(p - 1 - exp10), pBuffer);
+            pBuffer[cch] = 0;
+        }
+        else
         {
-            p += u8_to_hex_upper(pData[7u - i], p);
+            cch = FormatFloatPrecise(n, false, precision, pBuffer);
         }
-
-        p += MemCpyFromLiteral(p, ")");
-        assert(p == pBuffer + 28);
-        assert(pBuffer[28] == 0);
     }
 
-    return 28;
+    return cch;
 }
 
-unsigned JsonRenderTime(
-    TimeStruct const t,
-    _Out_writes_z_(29) char* pBuffer) noexcept
+unsigned JsonRenderDecimal(DecimalStruct d, _Out_writes_z_(40) char* pBuffer) noexcept
 {
-    return RenderFileTime(t.Value(), pBuffer);
-}
+    auto const mantissa = d.Mantissa();
+    char* pch = pBuffer;
 
-unsigned JsonRenderTime(
-    std::chrono::system_clock::time_point const timePoint,
-    _Out_writes_z_(29) char* pBuffer) noexcept
-{
-    uint64_t const ft = FileTime1970Ticks + std::chrono::duration_cast<ticks>(timePoint.time_since_epoch()).count();
-    return RenderFileTime(ft, pBuffer);
+    // Work with the magnitude as unsigned so that INT64_MIN is handled.
+    auto magnitude = static_cast<uint64_t>(mantissa);
+    if (mantissa < 0)
+    {
+        *pch++ = '-';
+        magnitude = 0 - magnitude;
+    }
+
+    char digits[20];
+    auto const cDigits = static_cast<unsigned>(
+        std::to_chars(digits, digits + sizeof(digits), magnitude).ptr - digits);
+
+    if (d.Scale <= 0)
+    {
+        // "12e3"
+        memcpy(pch, digits, cDigits);
+        pch += cDigits;
+        if (d.Scale != 0 && magnitude != 0)
+        {
+            *pch++ = 'e';
+            pch += JsonRenderUInt(0u - static_cast<unsigned>(d.Scale), pch);
+        }
+    }
+    else
+    {
+        auto const scale = static_cast<unsigned>(d.Scale);
+        if (scale < cDigits)
+        {
+            // "123.45"
+            auto const cInteger = cDigits - scale;
+            memcpy(pch, digits, cInteger);
+            pch += cInteger;
+            *pch++ = '.';
+            memcpy(pch, digits + cInteger, scale);
+            pch += scale;
+        }
+        else if (scale - cDigits <= 5)
+        {
+            // "0.00123"
+            auto const cZeros = scale - cDigits;
+            *pch++ = '0';
+            *pch++ = '.';
+            memset(pch, '0', cZeros);
+            pch += cZeros;
+            memcpy(pch, digits, cDigits);
+            pch += cDigits;
+        }
+        else
+        {
+            // "1.23e-10"
+            *pch++ = digits[0];
+            if (cDigits > 1)
+            {
+                *pch++ = '.';
+                memcpy(pch, digits + 1, cDigits - 1);
+                pch += cDigits - 1;
+            }
+            *pch++ = 'e';
+            *pch++ = '-';
+            pch += JsonRenderUInt(scale - (cDigits - 1), pch);
+        }
+    }
+
+    *pch = 0;
+    return static_cast<unsigned>(pch - pBuffer);
 }
 
-unsigned JsonRenderUuid(_In_reads_(16) char unsigned const* g, _Out_writes_z_(37) char* pBuffer) noexcept
+unsigned JsonRenderBool(bool b, _Out_writes_z_(6) char* pBuffer) noexcept
 {
-    u8_to_hex_upper(g[0], pBuffer + 0);
-    u8_to_hex_upper(g[1], pBuffer + 2);
-    u8_to_hex_upper(g[2], pBuffer + 4);
-    u8_to_hex_upper(g[3], pBuffer + 6);
-    pBuffer[8] = '-';
-    u8_to_hex_upper(g[4], pBuffer + 9);
-    u8_to_hex_upper(g[5], pBuffer + 11);
-    pBuffer[13] = '-';
-    u8_to_hex_upper(g[6], pBuffer + 14);
-    u8_to_hex_upper(g[7], pBuffer + 16);
-    pBuffer[18] = '-';
-    u8_to_hex_upper(g[8], pBuffer + 19);
-    u8_to_hex_upper(g[9], pBuffer + 21);
-    pBuffer[23] = '-';
-    u8_to_hex_upper(g[10], pBuffer + 24);
-    u8_to_hex_upper(g[11], pBuffer + 26);
-    u8_to_hex_upper(g[12], pBuffer + 28);
-    u8_to_hex_upper(g[13], pBuffer + 30);
-    u8_to_hex_upper(g[14], pBuffer + 32);
-    u8_to_hex_upper(g[15], pBuffer + 34);
-    pBuffer[36] = 0;
-    return 36;
+    return b ? MemCpyFromLiteral(pBuffer, "true") : MemCpyFromLiteral(pBuffer, "false");
 }
 
-unsigned JsonRenderUuidWithBraces(_In_reads_(16) char unsigned const* g, _Out_writes_z_(39) char* pBuffer) noexcept
+unsigned JsonRenderNull(_Out_writes_z_(5) char* pBuffer) noexcept
 {
-    pBuffer[0] = '{';
-    JsonRenderUuid(g, pBuffer + 1);
-    pBuffer[37] = '}';
-    pBuffer[38] = 0;
-    return 38;
+    return MemCpyFromLiteral(pBuffer, "null");
 }
 
-JsonRenderer::~JsonRenderer()
+static char const DigitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Writes n (0..99) as exactly 2 digits.
+static void Format2Digits(unsigned n, _Out_writes_(2) char* pch) noexcept
 {
-    return;
+    assert(n < 100);
+    memcpy(pch, DigitPairs + n * 2, 2);
 }
 
-JsonRenderer::JsonRenderer(
-    bool pretty,
-    std::string_view newLine,
-    unsigned indentSpaces) noexcept
-    : m_newLine(newLine), m_indentSpaces(indentSpaces), m_indent(0), m_pretty(pretty)
+// Divisors that reduce 100ns ticks (7 fractional digits) to N digits.
+static unsigned const TicksPerFractionDigits[] = {
+    10000000, 1000000, 100000, 10000, 1000, 100, 10, 1 };
+
+/*
+Writes seconds1601 (seconds since 1601-01-01T00:00:00Z) as
+"YYYY-MM-DDThh:mm:ss" (19 chars, not nul-terminated). Uses Howard Hinnant's
+days-to-civil algorithm, so no libc, locking, or time zone lookups.
+Requires seconds1601 < FileTime10000Ticks / TicksPerSecond.
+*/
+static void FormatIsoSeconds(uint64_t seconds1601, _Out_writes_(19) char* pBuffer) noexcept
 {
-    return;
+    auto const days1601 = static_cast<unsigned>(seconds1601 / 86400);
+    auto const secondOfDay = static_cast<unsigned>(seconds1601 % 86400);
+
+    // Count days from 0000-03-01 so that leap days fall at the end of a year
+    // and everything stays unsigned.
+    auto const days0300 = days1601 + 584694u;
+    auto const era = days0300 / 146097;                                     // 400-year cycle
+    auto const doe = days0300 - era * 146097;                               // [0, 146096]
+    auto const yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365; // [0, 399]
+    auto const doy = doe - (365 * yoe + yoe / 4 - yoe / 100);               // [0, 365]
+    auto const mp = (5 * doy + 2) / 153;                                    // [0, 11], March = 0
+    auto const day = doy - (153 * mp + 2) / 5 + 1;
+    auto const month = mp < 10 ? mp + 3 : mp - 9;
+    auto const year = era * 400 + yoe + (month <= 2 ? 1 : 0);
+
+    Format2Digits(year / 100, pBuffer + 0);
+    Format2Digits(year % 100, pBuffer + 2);
+    pBuffer[4] = '-';
+    Format2Digits(month, pBuffer + 5);
+    pBuffer[7] = '-';
+    Format2Digits(day, pBuffer + 8);
+    pBuffer[10] = 'T';
+    Format2Digits(secondOfDay / 3600, pBuffer + 11);
+    pBuffer[13] = ':';
+    Format2Digits(secondOfDay / 60 % 60, pBuffer + 14);
+    pBuffer[16] = ':';
+    Format2Digits(secondOfDay % 60, pBuffer + 17);
 }
 
-void JsonRenderer::Reserve(size_type cb)
+/*
+Writes the "[.f...]Z" suffix for ft with cFracDigits (0..7) fraction digits
+(truncated), followed by a nul.
+Returns the number of characters written, not counting the nul-termination.
+*/
+static unsigned
+FormatIsoFraction(uint64_t ft, unsigned cFracDigits, _Out_writes_z_(10) char* pBuffer) noexcept
 {
-    m_renderBuffer.reserve(cb);
+    assert(cFracDigits <= 7);
+
+    auto p = pBuffer;
+    if (cFracDigits != 0)
+    {
+        auto const subsecondTicks = static_cast<unsigned>(ft % TicksPerSecond);
+        *p++ = '.';
+        FormatUint(subsecondTicks / TicksPerFractionDigits[cFracDigits], p, cFracDigits);
+        p += cFracDigits;
+    }
+
+    *p++ = 'Z';
+    *p = 0;
+    return static_cast<unsigned>(p - pBuffer);
 }
 
-JsonRenderer::size_type JsonRenderer::Size() const noexcept
+/*
+Renders ft as "FILETIME(0x0123456789ABCDEF)" (28 chars). Used for values
+that cannot be rendered as a date-time.
+*/
+static unsigned
+RenderFileTimeRaw(uint64_t ft, _Out_writes_z_(29) char* pBuffer) noexcept
 {
-    return m_renderBuffer.size();
+    auto p = pBuffer;
+    p += MemCpyFromLiteral(p, "FILETIME(0x");
+
+    auto const pData = reinterpret_cast<unsigned char const*>(&ft);
+    for (unsigned i = 0; i != 8; i += 1)
+    {
+        p += u8_to_hex_upper(pData[7u - i], p);
+    }
+
+    p += MemCpyFromLiteral(p, ")");
+    assert(p == pBuffer + 28);
+    assert(pBuffer[28] == 0);
+    return 28;
 }
 
-JsonRenderer::size_type JsonRenderer::Capacity() const noexcept
+/*
+Renders ft as "YYYY-MM-DDThh:mm:ss[.f...]Z" with cFracDigits (0..7) fraction
+digits (truncated), or as "FILETIME(0x...)" if out of range.
+*/
+static unsigned
+RenderFileTime(uint64_t ft, unsigned cFracDigits, _Out_writes_z_(29) char* pBuffer) noexcept
 {
-    return m_renderBuffer.capacity();
+    // Only attempt to render years between 1601 and 9999.
+    if (ft < FileTime10000Ticks)
+    {
+        FormatIsoSeconds(ft / TicksPerSecond, pBuffer);
+        return 19 + FormatIsoFraction(ft, cFracDigits, pBuffer + 19);
+    }
+    else
+    {
+        return RenderFileTimeRaw(ft, pBuffer);
+    }
 }
 
-bool JsonRenderer::Pretty() const noexcept
+/*
+Renders ft as a signed integer count of ticksPerUnit-sized units since
+1970-01-01T00:00:00Z, rounded toward negative infinity.
+*/
+static unsigned
+RenderFileTimeEpoch(uint64_t ft, unsigned ticksPerUnit, _Out_writes_z_(21) char* pBuffer) noexcept
 {
-    return m_pretty;
+    if (ft >= FileTime1970Ticks)
+    {
+        return JsonRenderUInt((ft - FileTime1970Ticks) / ticksPerUnit, pBuffer);
+    }
+    else
+    {
+        auto const before = FileTime1970Ticks - ft;
+        auto const units = (before + ticksPerUnit - 1) / ticksPerUnit;
+        return JsonRenderInt(-static_cast<int64_t>(units), pBuffer);
+    }
 }
 
-void JsonRenderer::Pretty(bool value) noexcept
+/*
+Returns true for the formats that render as a string (the Iso formats),
+false for the formats that render as an integer.
+*/
+static bool
+TimeFormatIsString(JsonTimeFormat format) noexcept
 {
-    m_pretty = value;
+    switch (format)
+    {
+    case JsonTimeIso:
+    case JsonTimeIsoMicros:
+    case JsonTimeIsoMillis:
+    case JsonTimeIsoSeconds:
+        return true;
+    default:
+        return false;
+    }
 }
 
-std::string_view JsonRenderer::NewLine() const noexcept
+unsigned JsonRenderTime(
+    TimeStruct const t,
+    _Out_writes_z_(29) char* pBuffer) noexcept
 {
-    return m_newLine;
+    return RenderFileTime(t.Value(), 7, pBuffer);
+}
+
+unsigned JsonRenderTime(
+    std::chrono::system_clock::time_point const timePoint,
+    _Out_writes_z_(29) char* pBuffer) noexcept
+{
+    uint64_t const ft = FileTime1970Ticks + std::chrono::duration_cast<ticks>(timePoint.time_since_epoch()).count();
+    return RenderFileTime(ft, 7, pBuffer);
+}
+
+unsigned JsonRenderTime(
+    TimeStruct const t,
+    JsonTimeFormat format,
+    _Out_writes_z_(29) char* pBuffer) noexcept
+{
+    auto const ft = t.Value();
+    unsigned cch;
+
+    switch (format)
+    {
+    default:
+        assert(!"JsonRenderTime: invalid JsonTimeFormat");
+        cch = RenderFileTime(ft, 7, pBuffer);
+        break;
+    case JsonTimeIso:
+        cch = RenderFileTime(ft, 7, pBuffer);
+        break;
+    case JsonTimeIsoMicros:
+        cch = RenderFileTime(ft, 6, pBuffer);
+        break;
+    case JsonTimeIsoMillis:
+        cch = RenderFileTime(ft, 3, pBuffer);
+        break;
+    case JsonTimeIsoSeconds:
+        cch = RenderFileTime(ft, 0, pBuffer);
+        break;
+    case JsonTimeEpochSeconds:
+        cch = RenderFileTimeEpoch(ft, TicksPerSecond, pBuffer);
+        break;
+    case JsonTimeEpochMillis:
+        cch = RenderFileTimeEpoch(ft, TicksPerSecond / 1000, pBuffer);
+        break;
+    case JsonTimeEpochMicros:
+        cch = RenderFileTimeEpoch(ft, TicksPerSecond / 1000000, pBuffer);
+        break;
+    case JsonTimeFileTime:
+        cch = JsonRenderUInt(ft, pBuffer);
+        break;
+    }
+
+    return cch;
+}
+
+unsigned JsonRenderTime(
+    std::chrono::system_clock::time_point const timePoint,
+    JsonTimeFormat format,
+    _Out_writes_z_(29) char* pBuffer) noexcept
+{
+    uint64_t const ft = FileTime1970Ticks + std::chrono::duration_cast<ticks>(timePoint.time_since_epoch()).count();
+    return JsonRenderTime(TimeStruct::FromValue(ft), format, pBuffer);
+}
+
+/*
+Returns a pointer to the first character in [pch, pchEnd) that RenderString
+must escape (a control character, quote, or backslash), or pchEnd if none.
+*/
+static char const* FindEscapeChar(
+    _In_reads_(pchEnd - pch) char const* pch,
+    char const* pchEnd) noexcept
+{
+#if ESCAPE_USING_SSE2
+
+    // Test 16 bytes at a time: ch <= 0x1F (as unsigned) is detected via
+    // max_epu8(ch, 0x1F) == 0x1F.
+    auto const controlMax = _mm_set1_epi8(0x1F);
+    auto const quote = _mm_set1_epi8('"');
+    auto const backslash = _mm_set1_epi8('\\');
+    while (pchEnd - pch >= 16)
+    {
+        auto const input = _mm_loadu_si128(reinterpret_cast<__m128i const*>(pch));
+        auto const matches = _mm_or_si128(
+            _mm_cmpeq_epi8(_mm_max_epu8(input, controlMax), controlMax),
+            _mm_or_si128(
+                _mm_cmpeq_epi8(input, quote),
+                _mm_cmpeq_epi8(input, backslash)));
+        auto const mask = static_cast<unsigned>(_mm_movemask_epi8(matches));
+        if (mask != 0)
+        {
+#if defined(__GNUC__)
+            return pch + __builtin_ctz(mask);
+#else
+            unsigned i = 0;
+            while ((mask & (1u << i)) == 0)
+            {
+                i += 1;
+            }
+            return pch + i;
+#endif
+        }
+
+        pch += 16;
+    }
+
+#endif // ESCAPE_USING_SSE2
+
+    for (; pch != pchEnd; pch += 1)
+    {
+        auto const ch = static_cast<unsigned char>(*pch);
+        if (ch < 0x20 || ch == '"' || ch == '\\')
+        {
+            break;
+        }
+    }
+
+    return pch;
+}
+
+/*
+Writes the 16 bytes at pb as 32 hex digits (not nul-terminated).
+*/
+static void HexEncode16(
+    _In_reads_(16) char unsigned const* pb,
+    bool lowercase,
+    _Out_writes_(32) char* pch) noexcept
+{
+#if HEX_USING_SSE2
+
+    // Split each byte into nibbles, map 0..9 to '0'..'9' and 10..15 to
+    // 'A'..'F' (or 'a'..'f') with a compare and add, then interleave the
+    // high and low nibbles back into byte order.
+    auto const input = _mm_loadu_si128(reinterpret_cast<__m128i const*>(pb));
+    auto const mask0F = _mm_set1_epi8(0x0F);
+    auto const hi = _mm_and_si128(_mm_srli_epi16(input, 4), mask0F);
+    auto const lo = _mm_and_si128(input, mask0F);
+    auto const digit0 = _mm_set1_epi8('0');
+    auto const nine = _mm_set1_epi8(9);
+    auto const letterOffset = _mm_set1_epi8(lowercase ? 'a' - '0' - 10 : 'A' - '0' - 10);
+    auto const hiChars = _mm_add_epi8(
+        _mm_add_epi8(hi, digit0),
+        _mm_and_si128(_mm_cmpgt_epi8(hi, nine), letterOffset));
+    auto const loChars = _mm_add_epi8(
+        _mm_add_epi8(lo, digit0),
+        _mm_and_si128(_mm_cmpgt_epi8(lo, nine), letterOffset));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pch + 0), _mm_unpacklo_epi8(hiChars, loChars));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pch + 16), _mm_unpackhi_epi8(hiChars, loChars));
+
+#else // HEX_USING_SSE2
+
+    auto const digits = lowercase ? "0123456789abcdef" : "0123456789ABCDEF";
+    for (unsigned i = 0; i != 16; i += 1)
+    {
+        pch[i * 2 + 0] = digits[pb[i] >> 4];
+        pch[i * 2 + 1] = digits[pb[i] & 0xF];
+    }
+
+#endif // HEX_USING_SSE2
+}
+
+unsigned JsonRenderUuid(
+    _In_reads_(16) char unsigned const* g,
+    JsonUuidFormat format,
+    _Out_writes_z_(37) char* pBuffer) noexcept
+{
+    auto const lowercase = format == JsonUuidLowercase || format == JsonUuidLowercaseCompact;
+    unsigned cch;
+
+    if (format == JsonUuidUppercaseCompact || format == JsonUuidLowercaseCompact)
+    {
+        HexEncode16(g, lowercase, pBuffer);
+        cch = 32;
+    }
+    else
+    {
+        char hex[32];
+        HexEncode16(g, lowercase, hex);
+        memcpy(pBuffer + 0, hex + 0, 8);
+        pBuffer[8] = '-';
+        memcpy(pBuffer + 9, hex + 8, 4);
+        pBuffer[13] = '-';
+        memcpy(pBuffer + 14, hex + 12, 4);
+        pBuffer[18] = '-';
+        memcpy(pBuffer + 19, hex + 16, 4);
+        pBuffer[23] = '-';
+        memcpy(pBuffer + 24, hex + 20, 12);
+        cch = 36;
+    }
+
+    pBuffer[cch] = 0;
+    return cch;
+}
+
+unsigned JsonRenderUuid(_In_reads_(16) char unsigned const* g, _Out_writes_z_(37) char* pBuffer) noexcept
+{
+    return JsonRenderUuid(g, JsonUuidUppercase, pBuffer);
+}
+
+unsigned JsonRenderUuidWithBraces(_In_reads_(16) char unsigned const* g, _Out_writes_z_(39) char* pBuffer) noexcept
+{
+    pBuffer[0] = '{';
+    JsonRenderUuid(g, pBuffer + 1);
+    pBuffer[37] = '}';
+    pBuffer[38] = 0;
+    return 38;
+}
+
+JsonSink::~JsonSink()
+{
+    return;
+}
+
+JsonOstreamSink::JsonOstreamSink(std::ostream& stream) noexcept
+    : m_stream(stream)
+{
+    return;
+}
+
+void JsonOstreamSink::Write(std::string_view chunk)
+{
+    m_stream.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+}
+
+// Render cache entry values.
+auto constexpr RenderCacheNone = ~0u;  // RenderCacheEntry::parent for root or new values.
+auto constexpr RenderCacheDirty = ~0u; // RenderCacheEntry::size if the text must be rendered.
+
+static char const* StorageAddress(JsonBuilder::const_iterator const& it) noexcept
+{
+    return reinterpret_cast<char const*>(&*it);
+}
+
+JsonRenderer::~JsonRenderer()
+{
+    return;
+}
+
+JsonRenderer::JsonRenderer(
+    bool pretty,
+    std::string_view newLine,
+    unsigned indentSpaces) noexcept
+    : m_nameCacheCount(0)
+    , m_nameCache(false)
+    , m_threadCount(1)
+    , m_owner(nullptr)
+    , m_newLine(newLine)
+    , m_indentSpaces(indentSpaces)
+    , m_indentChar(' ')
+    , m_indent(0)
+    , m_pretty(pretty)
+    , m_binaryFormat(JsonBinaryBase64)
+    , m_floatFormat(JsonFloatShortest)
+    , m_floatPrecision(6)
+    , m_timeFormat(JsonTimeIso)
+    , m_uuidFormat(JsonUuidUppercase)
+    , m_timeCacheSeconds(~JsonInternal::JSON_UINT64(0))
+    , m_timeCacheText()
+    , m_sink(nullptr)
+    , m_chunkSize(65536)
+    , m_maxDepth(0)
+    , m_customRenderers()
+    , m_renderCache(false)
+    , m_renderCacheCount(0)
+    , m_renderCacheStorage(nullptr)
+{
+    return;
+}
+
+void JsonRenderer::CopySettings(JsonRenderer const& other) noexcept
+{
+    m_newLine = other.m_newLine;
+    m_indentSpaces = other.m_indentSpaces;
+    m_indentChar = other.m_indentChar;
+    m_pretty = other.m_pretty;
+    m_binaryFormat = other.m_binaryFormat;
+    m_floatFormat = other.m_floatFormat;
+    m_floatPrecision = other.m_floatPrecision;
+    m_timeFormat = other.m_timeFormat;
+    m_uuidFormat = other.m_uuidFormat;
+    m_nameCache = other.m_nameCache;
+    memcpy(m_customRenderers, other.m_customRenderers, sizeof(m_customRenderers));
+}
+
+void JsonRenderer::Reserve(size_type cb)
+{
+    m_renderBuffer.reserve(cb);
+}
+
+JsonRenderer::size_type JsonRenderer::Size() const noexcept
+{
+    return m_renderBuffer.size();
+}
+
+JsonRenderer::size_type JsonRenderer::Capacity() const noexcept
+{
+    return m_renderBuffer.capacity();
+}
+
+bool JsonRenderer::Pretty() const noexcept
+{
+    return m_pretty;
+}
+
+void JsonRenderer::Pretty(bool value) noexcept
+{
+    m_pretty = value;
+    m_renderCacheCount = 0;
+    m_nameCacheTable.clear();
+    m_nameCacheData.clear();
+    m_nameCacheCount = 0;
+}
+
+bool JsonRenderer::NameCache() const noexcept
+{
+    return m_nameCache;
+}
+
+void JsonRenderer::NameCache(bool value) noexcept
+{
+    m_nameCache = value;
+    m_nameCacheTable.clear();
+    m_nameCacheData.clear();
+    m_nameCacheCount = 0;
+}
+
+std::string_view JsonRenderer::NewLine() const noexcept
+{
+    return m_newLine;
 }
 
 void JsonRenderer::NewLine(std::string_view const value) noexcept
 {
-    m_newLine = value;
+    m_newLine = value;
+    m_newLineIndent.clear();
+    m_renderCacheCount = 0;
+}
+
+unsigned JsonRenderer::IndentSpaces() const noexcept
+{
+    return m_indentSpaces;
+}
+
+void JsonRenderer::IndentSpaces(unsigned value) noexcept
+{
+    m_indentSpaces = value;
+    m_renderCacheCount = 0;
+}
+
+char JsonRenderer::IndentChar() const noexcept
+{
+    return m_indentChar;
+}
+
+void JsonRenderer::IndentChar(char value)
+{
+    if (value != ' ' && value != '\t')
+    {
+        JsonThrowInvalidArgument("JsonRenderer - invalid IndentChar");
+    }
+
+    m_indentChar = value;
+    m_newLineIndent.clear();
+    m_renderCacheCount = 0;
+}
+
+JsonBinaryFormat JsonRenderer::BinaryFormat() const noexcept
+{
+    return m_binaryFormat;
+}
+
+void JsonRenderer::BinaryFormat(JsonBinaryFormat value) noexcept
+{
+    m_binaryFormat = value;
+    m_renderCacheCount = 0;
+}
+
+JsonFloatFormat JsonRenderer::FloatFormat() const noexcept
+{
+    return m_floatFormat;
+}
+
+void JsonRenderer::FloatFormat(JsonFloatFormat value) noexcept
+{
+    m_floatFormat = value;
+    m_renderCacheCount = 0;
+}
+
+unsigned JsonRenderer::FloatPrecision() const noexcept
+{
+    return m_floatPrecision;
+}
+
+void JsonRenderer::FloatPrecision(unsigned value) noexcept
+{
+    m_floatPrecision = static_cast<unsigned char>(value < 17 ? value : 17);
+    m_renderCacheCount = 0;
+}
+
+JsonTimeFormat JsonRenderer::TimeFormat() const noexcept
+{
+    return m_timeFormat;
+}
+
+void JsonRenderer::TimeFormat(JsonTimeFormat value)
+{
+    if (value > JsonTimeFileTime)
+    {
+        JsonThrowInvalidArgument("JsonRenderer - time format out of range");
+    }
+
+    m_timeFormat = value;
+    m_renderCacheCount = 0;
+}
+
+JsonUuidFormat JsonRenderer::UuidFormat() const noexcept
+{
+    return m_uuidFormat;
+}
+
+void JsonRenderer::UuidFormat(JsonUuidFormat value) noexcept
+{
+    m_uuidFormat = value;
+    m_renderCacheCount = 0;
+}
+
+std::string_view JsonRenderer::Render(JsonBuilder const& builder)
+{
+    if (m_renderCache && builder.ChangeCount() != 0 && builder.buffer_size() != 0)
+    {
+        return RenderWithCache(builder);
+    }
+
+    auto itRoot = builder.root();
+    m_renderCacheCount = 0;
+    m_renderBuffer.clear();
+    m_indent = 0;
+    RenderStructure(itRoot, true);
+    WriteChar('\0');
+    return std::string_view(m_renderBuffer.data(), m_renderBuffer.size() - 1);
+}
+
+std::string_view JsonRenderer::Render(JsonBuilder::const_iterator const& it)
+{
+    m_renderCacheCount = 0;
+    m_renderBuffer.clear();
+    m_indent = 0;
+    if (it.IsRoot())
+    {
+        RenderStructure(it, true);
+    }
+    else
+    {
+        RenderValue(it);
+    }
+    WriteChar('\0');
+    return std::string_view(m_renderBuffer.data(), m_renderBuffer.size() - 1);
+}
+
+std::string_view JsonRenderer::RenderWithCache(JsonBuilder const& builder)
+{
+    struct CacheScope
+    {
+        JsonRenderer& renderer;
+        ~CacheScope() { renderer.m_renderCacheStorage = nullptr; }
+    } scope{ *this };
+
+    m_renderCacheStorage = static_cast<char const*>(builder.buffer_data());
+    auto const changeCount = builder.ChangeCount();
+    auto const cEntries = static_cast<unsigned>(builder.buffer_size() / alignof(JsonValue));
+
+    // Mark the values that changed since the previous render, and their
+    // ancestors, as dirty. If the changes are not known, start over.
+    if (m_renderCacheCount == 0 ||
+        m_renderCacheEntries.size() > cEntries ||
+        !builder.ForEachChangeSince(
+            m_renderCacheCount,
+            [this](iterator const& it) noexcept { RenderCacheMarkDirty(RenderCacheIndex(it)); }))
+    {
+        m_renderCacheEntries.clear();
+    }
+    else
+    {
+        // Data written without JsonBuilder::MutableData (e.g. through a
+        // JsonValue reference) is not in the change log, and the previous
+        // text would be reused. Debug builds check for it.
+        assert(RenderCacheChangesRecorded(builder));
+
+        if (m_renderCacheEntries[0].size != RenderCacheDirty)
+        {
+            // Nothing changed. m_renderBuffer still holds the previous output.
+            m_renderCacheCount = changeCount;
+            return std::string_view(m_renderBuffer.data(), m_renderBuffer.size() - 1);
+        }
+    }
+
+    // Values added since the previous render have no text to reuse.
+    auto const cOld = m_renderCacheEntries.size();
+    m_renderCacheEntries.resize(cEntries);
+    for (auto i = cOld; i != cEntries; i += 1)
+    {
+        m_renderCacheEntries[i] = RenderCacheEntry{ RenderCacheNone, 0, RenderCacheDirty };
+    }
+
+    m_renderCacheCount = 0; // In case rendering throws.
+    m_renderCacheText.swap(m_renderBuffer);
+    m_renderBuffer.clear();
+    m_indent = 0;
+    RenderStructure(builder.root(), true);
+    m_renderCacheEntries[0] = RenderCacheEntry{ RenderCacheNone, 0, m_renderBuffer.size() };
+    WriteChar('\0');
+    m_renderCacheCount = changeCount;
+
+#ifndef NDEBUG
+    m_renderCacheStorageCopy.clear();
+    m_renderCacheStorageCopy.append(m_renderCacheStorage, builder.buffer_size());
+#endif
+
+    return std::string_view(m_renderBuffer.data(), m_renderBuffer.size() - 1);
+}
+
+bool JsonRenderer::RenderCacheChangesRecorded(JsonBuilder const& builder) const noexcept
+{
+    // A value whose data differs from the copy taken at the previous render
+    // must have been marked dirty, or its text is copied from the previous
+    // output. Its parent's entry says whether it will be rendered again.
+    auto const pbOld = m_renderCacheStorageCopy.data();
+    auto const cbOld = m_renderCacheStorageCopy.size();
+    auto const pEntries = m_renderCacheEntries.data();
+    auto const cEntries = m_renderCacheEntries.size();
+    for (auto it = builder.begin(); it != builder.end(); ++it)
+    {
+        auto const type = it->Type();
+        if (type == JsonObject || type == JsonArray)
+        {
+            continue;
+        }
+
+        unsigned cb;
+        auto const pb = static_cast<char const*>(it->Data(&cb));
+        auto const offset = static_cast<size_t>(pb - m_renderCacheStorage);
+        auto const index = RenderCacheIndex(it);
+        if (index >= cEntries || offset + cb > cbOld || memcmp(pbOld + offset, pb, cb) == 0)
+        {
+            continue; // New or unchanged.
+        }
+
+        auto const parent = pEntries[index].parent;
+        if (parent != RenderCacheNone && pEntries[parent].size != RenderCacheDirty)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void JsonRenderer::RenderCacheMarkDirty(unsigned index) noexcept
+{
+    // Values added since the previous render have no entry. The array or
+    // object they were added to is also in the change log.
+    if (index < m_renderCacheEntries.size())
+    {
+        // Stop at an ancestor that is already dirty: its ancestors are too.
+        auto const pEntries = m_renderCacheEntries.data();
+        pEntries[index].size = RenderCacheDirty;
+        for (auto i = pEntries[index].parent;
+             i != RenderCacheNone && pEntries[i].size != RenderCacheDirty;
+             i = pEntries[i].parent)
+        {
+            pEntries[i].size = RenderCacheDirty;
+        }
+    }
+}
+
+unsigned JsonRenderer::RenderCacheIndex(iterator const& it) const noexcept
+{
+    return it.IsRoot()
+        ? 0u
+        : static_cast<unsigned>((StorageAddress(it) - m_renderCacheStorage) / alignof(JsonValue));
+}
+
+JsonRenderToResult JsonRenderer::RenderTo(
+    JsonBuilder const& builder,
+    _Out_writes_(cchDest) char* dest,
+    size_t cchDest)
+{
+    return RenderTo(builder.root(), dest, cchDest);
+}
+
+JsonRenderToResult JsonRenderer::RenderTo(
+    JsonBuilder::const_iterator const& it,
+    _Out_writes_(cchDest) char* dest,
+    size_t cchDest)
+{
+    // Render into dest in place of m_renderBuffer. Worst-case reservations
+    // (e.g. for packed arrays) may move the output to an allocated buffer
+    // even if the final text fits, so check the final size and copy back.
+    RenderBuffer output;
+    output.attach(
+        dest,
+        cchDest < RenderBuffer::max_size()
+            ? static_cast<RenderBuffer::size_type>(cchDest)
+            : RenderBuffer::max_size());
+
+    struct BufferScope
+    {
+        RenderBuffer& a;
+        RenderBuffer& b;
+        ~BufferScope() { a.swap(b); }
+    } scope{ m_renderBuffer, output };
+    m_renderBuffer.swap(output);
+
+    m_indent = 0;
+    if (it.IsRoot())
+    {
+        RenderStructure(it, true);
+    }
+    else
+    {
+        RenderValue(it);
+    }
+
+    JsonRenderToResult result;
+    result.Size = m_renderBuffer.size();
+    result.Truncated = result.Size > cchDest;
+    if (!result.Truncated)
+    {
+        if (!m_renderBuffer.attached())
+        {
+            memcpy(dest, m_renderBuffer.data(), result.Size);
+        }
+
+        if (result.Size < cchDest)
+        {
+            dest[result.Size] = '\0';
+        }
+    }
+
+    return result;
+}
+
+size_t JsonRenderer::MeasureSize(JsonBuilder const& builder)
+{
+    return MeasureSize(builder.root());
 }
 
-unsigned JsonRenderer::IndentSpaces() const noexcept
+size_t JsonRenderer::MeasureSize(JsonBuilder::const_iterator const& it)
 {
-    return m_indentSpaces;
+    m_indent = 0;
+    return it.IsRoot()
+        ? MeasureStructure(it, true)
+        : MeasureValue(it);
 }
 
-void JsonRenderer::IndentSpaces(unsigned value) noexcept
+JsonRenderCustomFunction* JsonRenderer::CustomRenderer(JsonType type) const noexcept
 {
-    m_indentSpaces = value;
+    return m_customRenderers[type & 0xFF].function;
 }
 
-std::string_view JsonRenderer::Render(JsonBuilder const& builder)
+void JsonRenderer::CustomRenderer(
+    JsonType type,
+    JsonRenderCustomFunction* function,
+    void* context)
 {
-    auto itRoot = builder.root();
-    m_renderBuffer.clear();
-    m_indent = 0;
-    RenderStructure(itRoot, true);
-    WriteChar('\0');
-    return std::string_view(m_renderBuffer.data(), m_renderBuffer.size() - 1);
+    if (type < 1 || type > 200)
+    {
+        JsonThrowInvalidArgument("JsonRenderer - custom type out of range");
+    }
+
+    m_customRenderers[type].function = function;
+    m_customRenderers[type].context = function ? context : nullptr;
+    m_renderCacheCount = 0;
 }
 
-std::string_view JsonRenderer::Render(JsonBuilder::const_iterator const& it)
+bool JsonRenderer::RenderCache() const noexcept
+{
+    return m_renderCache;
+}
+
+void JsonRenderer::RenderCache(bool value) noexcept
+{
+    m_renderCache = value;
+    m_renderCacheCount = 0;
+    if (!value)
+    {
+        m_renderCacheEntries.clear();
+        m_renderCacheText.clear();
+    }
+}
+
+unsigned JsonRenderer::ThreadCount() const noexcept
+{
+    return m_threadCount;
+}
+
+void JsonRenderer::ThreadCount(unsigned value) noexcept
+{
+    m_threadCount = value < 1 ? 1 : value;
+}
+
+unsigned JsonRenderer::MaxDepth() const noexcept
+{
+    return m_maxDepth;
+}
+
+void JsonRenderer::MaxDepth(unsigned value) noexcept
+{
+    m_maxDepth = value;
+    m_renderCacheCount = 0;
+}
+
+JsonRenderer::size_type JsonRenderer::ChunkSize() const noexcept
+{
+    return m_chunkSize;
+}
+
+void JsonRenderer::ChunkSize(size_type value) noexcept
+{
+    m_chunkSize = value < 1 ? 1 : value;
+}
+
+void JsonRenderer::Render(JsonBuilder const& builder, JsonSink& sink)
+{
+    Render(builder.root(), sink);
+}
+
+void JsonRenderer::Render(JsonBuilder::const_iterator const& it, JsonSink& sink)
 {
+    // Detach the sink even if rendering or the sink throws.
+    struct SinkScope
+    {
+        JsonRenderer& renderer;
+        ~SinkScope() { renderer.m_sink = nullptr; }
+    } scope{ *this };
+
+    m_renderCacheCount = 0;
     m_renderBuffer.clear();
     m_indent = 0;
+    m_sink = &sink;
     if (it.IsRoot())
     {
         RenderStructure(it, true);
@@ -370,18 +1542,41 @@ std::string_view JsonRenderer::Render(JsonBuilder::const_iterator const& it)
     {
         RenderValue(it);
     }
-    WriteChar('\0');
-    return std::string_view(m_renderBuffer.data(), m_renderBuffer.size() - 1);
+
+    FlushChunks();
+    if (!m_renderBuffer.empty())
+    {
+        sink.Write(std::string_view(m_renderBuffer.data(), m_renderBuffer.size()));
+    }
+    m_renderBuffer.clear();
+}
+
+void JsonRenderer::RenderCustomValue(iterator const& it)
+{
+    auto const& entry = m_customRenderers[it->Type()];
+    if (entry.function != nullptr)
+    {
+        entry.function(entry.context, m_renderBuffer, it);
+    }
+    else if (m_owner != nullptr)
+    {
+        // Parallel worker: use the overrides of the renderer that started it.
+        m_owner->RenderCustom(m_renderBuffer, it);
+    }
+    else
+    {
+        RenderCustom(m_renderBuffer, it);
+    }
 }
 
-void JsonRenderer::RenderCustom(RenderBuffer&, iterator const& it)
+void JsonRenderer::RenderCustom(RenderBuffer& buffer, iterator const& it)
 {
     auto const cchMax = 32u;
-    auto pch = m_renderBuffer.GetAppendPointer(cchMax);
+    auto pch = buffer.GetAppendPointer(cchMax);
     unsigned cch =
         static_cast<unsigned>(snprintf(pch, cchMax, "\"Custom#%u\"", it->Type()));
     pch += cch > cchMax ? cchMax : cch;
-    m_renderBuffer.SetEndPointer(pch);
+    buffer.SetEndPointer(pch);
 }
 
 void JsonRenderer::RenderValue(iterator const& it)
@@ -409,7 +1604,14 @@ void JsonRenderer::RenderValue(iterator const& it)
         }
         break;
     case JsonUtf8:
-        RenderString(it->GetUnchecked<std::string_view>());
+        if (it->IsEscapeFree())
+        {
+            RenderEscapeFreeString(it->GetUnchecked<std::string_view>());
+        }
+        else
+        {
+            RenderString(it->GetUnchecked<std::string_view>());
+        }
         break;
     case JsonFloat:
         RenderFloat(it->GetUnchecked<double>());
@@ -423,52 +1625,547 @@ void JsonRenderer::RenderValue(iterator const& it)
     case JsonTime:
         RenderTime(it->GetUnchecked<TimeStruct>());
         break;
+    case JsonDecimal:
+        RenderDecimal(it->GetUnchecked<DecimalStruct>());
+        break;
     case JsonUuid:
         RenderUuid(it->GetUnchecked<UuidStruct>().Data);
         break;
+    case JsonInt32Array:
+        RenderPackedArray<int32_t>(it);
+        break;
+    case JsonInt64Array:
+        RenderPackedArray<int64_t>(it);
+        break;
+    case JsonUInt32Array:
+        RenderPackedArray<uint32_t>(it);
+        break;
+    case JsonUInt64Array:
+        RenderPackedArray<uint64_t>(it);
+        break;
+    case JsonFloatArray:
+        RenderPackedArray<float>(it);
+        break;
+    case JsonDoubleArray:
+        RenderPackedArray<double>(it);
+        break;
+    case JsonBinary: {
+        unsigned cb;
+        auto const pb = it->Data(&cb);
+        RenderBinary(pb, cb);
+        break;
+    }
     default:
-        RenderCustom(m_renderBuffer, it);
+        RenderCustomValue(it);
+        break;
+    }
+}
+
+bool JsonRenderer::PushStructure(iterator const& itParent, bool showNames)
+{
+    if (m_maxDepth != 0 && m_structures.size() >= m_maxDepth)
+    {
+        JsonThrowLengthError("JsonRenderer - exceeded maximum depth");
+    }
+
+    auto it = itParent.begin();
+    auto itEnd = itParent.end();
+    if (it == itEnd)
+    {
+        return false;
+    }
+
+    m_structures.push_back(StructureFrame{ it, itEnd, showNames, true, 0, 0, RenderCacheNone });
+    return true;
+}
+
+void JsonRenderer::RenderStructure(iterator const& itParent, bool showNames)
+{
+    m_structures.clear();
+
+    iterator itParallel;
+    size_t cbParallel = 0;
+    auto const parallel =
+        m_threadCount > 1 &&
+        m_sink == nullptr &&
+        m_owner == nullptr &&
+        m_renderCacheStorage == nullptr &&
+        FindParallelStructure(itParent, &itParallel, &cbParallel);
+
+    WriteChar(showNames ? '{' : '[');
+    if (parallel && itParallel == itParent)
+    {
+        RenderParallelChildren(itParent, cbParallel, showNames);
+        return;
+    }
+
+    if (!PushStructure(itParent, showNames))
+    {
+        WriteChar(showNames ? '}' : ']');
+        return;
+    }
+
+    if (m_renderCacheStorage != nullptr)
+    {
+        // The root's previous text starts at offset 0.
+        m_structures[0].oldStart = 0;
+    }
+
+    m_indent += m_indentSpaces;
+    RenderFrames(parallel ? &itParallel : nullptr, cbParallel);
+    m_indent -= m_indentSpaces;
+
+    if (m_pretty)
+    {
+        RenderNewline();
+    }
+
+    WriteChar(showNames ? '}' : ']');
+}
+
+void JsonRenderer::RenderFrames(iterator const* pParallel, size_t cbParallel)
+{
+    auto const cBase = m_structures.size();
+    assert(cBase != 0);
+
+    for (;;)
+    {
+        auto& frame = m_structures[m_structures.size() - 1];
+        if (frame.it == frame.itEnd)
+        {
+            auto const closeChar = frame.showNames ? '}' : ']';
+            auto const node = frame.node;
+            auto const start = frame.start;
+            m_structures.resize(m_structures.size() - 1);
+
+            if (m_structures.size() < cBase)
+            {
+                // Caller closes the bottom frame.
+                break;
+            }
+
+            // Last child is done. Close the structure.
+            m_indent -= m_indentSpaces;
+
+            if (m_pretty)
+            {
+                RenderNewline();
+            }
+
+            WriteChar(closeChar);
+            if (m_renderCacheStorage != nullptr)
+            {
+                m_renderCacheEntries[node].size = m_renderBuffer.size() - start;
+            }
+
+            FlushChunks();
+            continue;
+        }
+
+        auto const it = frame.it;
+        ++frame.it;
+
+        if (!frame.first)
+        {
+            WriteChar(',');
+        }
+        frame.first = false;
+
+        if (m_pretty)
+        {
+            RenderNewline();
+        }
+
+        if (frame.showNames)
+        {
+            RenderName(it);
+        }
+
+        auto const type = it->Type();
+        if (type == JsonObject || type == JsonArray)
+        {
+            // Note: PushStructure may invalidate frame.
+            auto const childShowNames = type == JsonObject;
+            auto node = 0u;
+            auto oldStart = RenderCacheNone;
+            if (m_renderCacheStorage != nullptr)
+            {
+                // If the child was rendered under the same parent last time,
+                // its previous text is at the same offset in the parent's
+                // previous text. Copy it if nothing in the child changed.
+                node = RenderCacheIndex(it);
+                auto& entry = m_renderCacheEntries[node];
+                auto const offset = m_renderBuffer.size() - frame.start;
+                if (entry.parent == frame.node && frame.oldStart != RenderCacheNone)
+                {
+                    oldStart = frame.oldStart + entry.offset;
+                    if (entry.size != RenderCacheDirty)
+                    {
+                        WriteChars(m_renderCacheText.data() + oldStart, entry.size);
+                        entry.offset = offset;
+                        continue;
+                    }
+                }
+
+                entry = RenderCacheEntry{ frame.node, offset, RenderCacheDirty };
+            }
+
+            WriteChar(childShowNames ? '{' : '[');
+            if (pParallel != nullptr && it == *pParallel)
+            {
+                RenderParallelChildren(it, cbParallel, childShowNames);
+            }
+            else if (PushStructure(it, childShowNames))
+            {
+                if (m_renderCacheStorage != nullptr)
+                {
+                    auto& child = m_structures[m_structures.size() - 1];
+                    child.node = node;
+                    child.start = m_renderBuffer.size() - 1;
+                    child.oldStart = oldStart;
+                }
+
+                m_indent += m_indentSpaces;
+                continue;
+            }
+            else
+            {
+                WriteChar(childShowNames ? '}' : ']');
+                if (m_renderCacheStorage != nullptr)
+                {
+                    m_renderCacheEntries[node].size = 2;
+                }
+            }
+        }
+        else
+        {
+            if (m_renderCacheStorage != nullptr)
+            {
+                m_renderCacheEntries[RenderCacheIndex(it)].parent = frame.node;
+            }
+
+            RenderValue(it);
+        }
+
+        FlushChunks();
+    }
+}
+
+// Parallel rendering is used for structures whose children use at least
+// ParallelMinBytes of builder storage, with at least ParallelMinBytesPerRange
+// per thread.
+auto constexpr ParallelMinBytesPerRange = 64u * 1024u;
+auto constexpr ParallelMinBytes = 4u * ParallelMinBytesPerRange;
+
+/*
+Returns the end of the storage used by the value at it and its descendants,
+found by following the child with the highest address (the child stored
+last, wherever push_front or splice put it in the list) of each
+array/object.
+*/
+static char const* StorageEnd(JsonBuilder::const_iterator const& it) noexcept
+{
+    auto itHigh = it;
+    for (;;)
+    {
+        auto const type = itHigh->Type();
+        if (type != JsonObject && type != JsonArray)
+        {
+            return StorageAddress(itHigh) + sizeof(JsonValue) + itHigh->DataSize();
+        }
+
+        auto itChild = itHigh.begin();
+        auto const itEnd = itHigh.end();
+        if (itChild == itEnd)
+        {
+            return StorageAddress(itHigh) + sizeof(JsonValue);
+        }
+
+        itHigh = itChild;
+        for (++itChild; itChild != itEnd; ++itChild)
+        {
+            if (StorageAddress(itChild) > StorageAddress(itHigh))
+            {
+                itHigh = itChild;
+            }
+        }
+    }
+}
+
+/*
+Calls onChild(it, cb) for each child of itParent, where cb estimates the
+builder storage used by the child and its descendants, and returns the
+sum. The estimate is the distance from the child to the next child, in
+either direction (children added by push_front are stored in reverse
+order), or for the last child, the distance to StorageEnd.
+*/
+template<class OnChild>
+static size_t ForEachChildStorage(
+    JsonBuilder::const_iterator const& itParent,
+    OnChild&& onChild)
+{
+    size_t cbTotal = 0;
+    auto const itEnd = itParent.end();
+    for (auto it = itParent.begin(); it != itEnd;)
+    {
+        auto itNext = it;
+        ++itNext;
+
+        // Compare before subtracting: the difference may be negative.
+        auto const pb = StorageAddress(it);
+        auto const pbNext = itNext != itEnd ? StorageAddress(itNext) : StorageEnd(it);
+        auto const cb = static_cast<size_t>(pbNext > pb ? pbNext - pb : pb - pbNext);
+        onChild(it, cb);
+        cbTotal += cb;
+        it = itNext;
+    }
+
+    return cbTotal;
+}
+
+bool JsonRenderer::FindParallelStructure(
+    iterator const& itStart,
+    _Out_ iterator* pParallel,
+    _Out_ size_t* pcbParallel) const
+{
+    // Skip envelopes such as {"version":1,"items":[...]}: descend while one
+    // array or object child holds most of the structure's storage.
+    auto itParent = itStart;
+    size_t cbTotal;
+    for (;;)
+    {
+        size_t cChildren = 0;
+        size_t cbLargest = 0;
+        iterator itLargest;
+        cbTotal = ForEachChildStorage(
+            itParent,
+            [&](iterator const& it, size_t cb) {
+                cChildren += 1;
+                if (cb > cbLargest)
+                {
+                    cbLargest = cb;
+                    itLargest = it;
+                }
+            });
+
+        if (cbTotal < ParallelMinBytes)
+        {
+            return false;
+        }
+
+        auto const type = itLargest->Type();
+        if (cbLargest > cbTotal / 2 &&
+            cbLargest >= ParallelMinBytes &&
+            (type == JsonObject || type == JsonArray))
+        {
+            itParent = itLargest;
+            continue;
+        }
+
+        if (cChildren < 2)
+        {
+            return false;
+        }
+
         break;
     }
+
+    *pParallel = itParent;
+    *pcbParallel = cbTotal;
+    return true;
+}
+
+void JsonRenderer::RenderParallelChildren(
+    iterator const& itParent,
+    size_t cbChildren,
+    bool showNames)
+{
+    // Split the children into ranges with similar storage size.
+    auto const itFirst = itParent.begin();
+    auto const itEnd = itParent.end();
+    size_t const cRangesMax = cbChildren / ParallelMinBytesPerRange;
+    auto const cRanges = cRangesMax < m_threadCount ? cRangesMax : m_threadCount;
+    assert(cRanges > 1);
+
+    std::vector<iterator> rangeStarts;
+    rangeStarts.reserve(cRanges + 1);
+    rangeStarts.push_back(itFirst);
+    size_t cbBefore = 0;
+    ForEachChildStorage(
+        itParent,
+        [&](iterator const& it, size_t cb) {
+            auto const cbNext = rangeStarts.size() * cbChildren / cRanges;
+            if (rangeStarts.size() < cRanges && cbBefore >= cbNext)
+            {
+                rangeStarts.push_back(it);
+            }
+
+            cbBefore += cb;
+        });
+    auto const cActual = rangeStarts.size();
+    rangeStarts.push_back(itEnd);
+
+    // Depth of itParent. Workers start with only the range's frame on their
+    // structure stack, so their limit is reduced by the depth above it.
+    auto const depth = m_structures.size() + 1;
+    if (m_maxDepth != 0 && depth > m_maxDepth)
+    {
+        JsonThrowLengthError("JsonRenderer - exceeded maximum depth");
+    }
+
+    auto const childIndent = m_indent + m_indentSpaces;
+
+    // Ranges 1..N-1 go to worker threads. This thread renders range 0
+    // directly into m_renderBuffer, then appends the workers' output in order.
+    std::unique_ptr<JsonRenderer[]> workers(new JsonRenderer[cActual - 1]);
+    std::vector<std::exception_ptr> errors(cActual - 1);
+    std::vector<std::thread> threads;
+    threads.reserve(cActual - 1);
+
+    struct JoinScope
+    {
+        std::vector<std::thread>& threads;
+        ~JoinScope()
+        {
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+        }
+    } joinScope{ threads };
+
+    for (size_t i = 1; i != cActual; i += 1)
+    {
+        auto& worker = workers[i - 1];
+        worker.m_owner = this;
+        worker.CopySettings(*this);
+        worker.m_maxDepth = m_maxDepth == 0 ? 0 : m_maxDepth - static_cast<unsigned>(depth) + 1;
+
+        auto const itBegin = rangeStarts[i];
+        auto const itRangeEnd = rangeStarts[i + 1];
+        auto const pError = &errors[i - 1];
+        threads.emplace_back([&worker, itBegin, itRangeEnd, showNames, childIndent, pError]() {
+            try
+            {
+                worker.m_indent = childIndent;
+                worker.m_structures.push_back(StructureFrame{ itBegin, itRangeEnd, showNames, false, 0, 0, RenderCacheNone });
+                worker.RenderFrames(nullptr, 0);
+            }
+            catch (...)
+            {
+                *pError = std::current_exception();
+            }
+        });
+    }
+
+    m_indent = childIndent;
+    m_structures.push_back(StructureFrame{ itFirst, rangeStarts[1], showNames, true, 0, 0, RenderCacheNone });
+    RenderFrames(nullptr, 0);
+    m_indent -= m_indentSpaces;
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    threads.clear();
+
+    for (size_t i = 1; i != cActual; i += 1)
+    {
+        if (errors[i - 1])
+        {
+            std::rethrow_exception(errors[i - 1]);
+        }
+
+        auto const& buffer = workers[i - 1].m_renderBuffer;
+        WriteChars(buffer.data(), buffer.size());
+    }
+
+    if (m_pretty)
+    {
+        RenderNewline();
+    }
+
+    WriteChar(showNames ? '}' : ']');
 }
 
-void JsonRenderer::RenderStructure(iterator const& itParent, bool showNames)
+/*
+Writes one packed-array element. Caller must provide room for 32 chars.
+Returns the number of characters written (not nul-terminated).
+*/
+static unsigned RenderPackedElement(
+    float value,
+    JsonFloatFormat format,
+    unsigned precision,
+    _Out_writes_(32) char* pch) noexcept
 {
-    WriteChar(showNames ? '{' : '[');
+    return JsonRenderFloat(value, format, precision, pch);
+}
 
-    auto it = itParent.begin();
-    auto itEnd = itParent.end();
-    if (it != itEnd)
+static unsigned RenderPackedElement(
+    double value,
+    JsonFloatFormat format,
+    unsigned precision,
+    _Out_writes_(32) char* pch) noexcept
+{
+    return JsonRenderFloat(value, format, precision, pch);
+}
+
+template<class N>
+static unsigned RenderPackedElement(
+    N value,
+    JsonFloatFormat,
+    unsigned,
+    _Out_writes_(32) char* pch) noexcept
+{
+    auto const result = std::to_chars(pch, pch + 32, value);
+    assert(result.ec == std::errc());
+    return static_cast<unsigned>(result.ptr - pch);
+}
+
+template<class T>
+void JsonRenderer::RenderPackedArray(iterator const& it)
+{
+    unsigned cbData;
+    auto const pbData = static_cast<char unsigned const*>(it->Data(&cbData));
+    auto const cElements = cbData / sizeof(T);
+
+    WriteChar('[');
+
+    if (cElements != 0)
     {
         m_indent += m_indentSpaces;
 
-        for (;;)
-        {
-            if (m_pretty)
-            {
-                RenderNewline();
-            }
+        // Reserve worst-case space for a block of elements at a time so that
+        // the per-element loop does not need to check capacity.
+        auto const newLineIndent = m_pretty ? NewLineIndent() : std::string_view();
+        auto const cchNewline = newLineIndent.size();
+        auto const cchElementMax = 32u + 1u + cchNewline; // value + ',' + newline.
+        auto const cBlockMax = cchElementMax < 8192u ? 8192u / cchElementMax : 1u;
 
-            if (showNames)
+        for (size_t iElement = 0; iElement != cElements;)
+        {
+            auto const cBlock = cElements - iElement < cBlockMax ? cElements - iElement : cBlockMax;
+            auto pch = m_renderBuffer.GetAppendPointer(
+                static_cast<unsigned>(cBlock * cchElementMax));
+            for (auto const iEnd = iElement + cBlock; iElement != iEnd; iElement += 1)
             {
-                RenderString(it->Name());
-                WriteChar(':');
+                if (iElement != 0)
+                {
+                    *pch++ = ',';
+                }
 
                 if (m_pretty)
                 {
-                    WriteChar(' ');
+                    memcpy(pch, newLineIndent.data(), cchNewline);
+                    pch += cchNewline;
                 }
-            }
-
-            RenderValue(it);
 
-            ++it;
-            if (it == itEnd)
-            {
-                break;
+                T value;
+                memcpy(&value, pbData + iElement * sizeof(T), sizeof(T));
+                pch += RenderPackedElement(value, m_floatFormat, m_floatPrecision, pch);
             }
-
-            WriteChar(',');
+            m_renderBuffer.SetEndPointer(pch);
+            FlushChunks();
         }
 
         m_indent -= m_indentSpaces;
@@ -479,13 +2176,13 @@ void JsonRenderer::RenderStructure(iterator const& itParent, bool showNames)
         }
     }
 
-    WriteChar(showNames ? '}' : ']');
+    WriteChar(']');
 }
 
 void JsonRenderer::RenderFloat(double const value)
 {
     auto pch = m_renderBuffer.GetAppendPointer(32);
-    pch += JsonRenderFloat(value, pch);
+    pch += JsonRenderFloat(value, m_floatFormat, m_floatPrecision, pch);
     m_renderBuffer.SetEndPointer(pch);
 }
 
@@ -509,10 +2206,45 @@ void JsonRenderer::RenderUInt(long long unsigned const value)
 
 void JsonRenderer::RenderTime(TimeStruct value)
 {
+    static unsigned char const IsoFractionDigits[] = { 7, 6, 3, 0 };
+    auto const ft = value.Value();
+
     auto pch = m_renderBuffer.GetAppendPointer(32);
-    *pch++ = '"';
-    pch += RenderFileTime(value.Value(), pch);
-    *pch++ = '"';
+    if (TimeFormatIsString(m_timeFormat))
+    {
+        *pch++ = '"';
+        if (ft < FileTime10000Ticks)
+        {
+            // Consecutive values are usually in the same second, so reuse
+            // the date and time text from the previous value when possible.
+            auto const seconds1601 = ft / TicksPerSecond;
+            if (seconds1601 != m_timeCacheSeconds)
+            {
+                FormatIsoSeconds(seconds1601, m_timeCacheText);
+                m_timeCacheSeconds = seconds1601;
+            }
+
+            memcpy(pch, m_timeCacheText, sizeof(m_timeCacheText));
+            pch += sizeof(m_timeCacheText);
+            pch += FormatIsoFraction(ft, IsoFractionDigits[m_timeFormat], pch);
+        }
+        else
+        {
+            pch += RenderFileTimeRaw(ft, pch);
+        }
+        *pch++ = '"';
+    }
+    else
+    {
+        pch += JsonRenderTime(value, m_timeFormat, pch);
+    }
+    m_renderBuffer.SetEndPointer(pch);
+}
+
+void JsonRenderer::RenderDecimal(DecimalStruct value)
+{
+    auto pch = m_renderBuffer.GetAppendPointer(40);
+    pch += JsonRenderDecimal(value, pch);
     m_renderBuffer.SetEndPointer(pch);
 }
 
@@ -520,7 +2252,23 @@ void JsonRenderer::RenderUuid(_In_reads_(16) char unsigned const* value)
 {
     auto pch = m_renderBuffer.GetAppendPointer(38);
     *pch++ = '"';
-    pch += JsonRenderUuid(value, pch);
+    pch += JsonRenderUuid(value, m_uuidFormat, pch);
+    *pch++ = '"';
+    m_renderBuffer.SetEndPointer(pch);
+}
+
+void JsonRenderer::RenderBinary(_In_reads_bytes_(cb) void const* pb, unsigned cb)
+{
+    // Quotes + 4 chars per 3 bytes + nul. (cb <= DataMax, so no overflow.)
+    auto const cchMax = 2u + 4u * ((static_cast<uint64_t>(cb) + 2u) / 3u) + 1u;
+    if (cchMax > RenderBuffer::max_size())
+    {
+        JsonThrowLengthError("JsonRenderer - output too large");
+    }
+
+    auto pch = m_renderBuffer.GetAppendPointer(static_cast<unsigned>(cchMax));
+    *pch++ = '"';
+    pch += JsonRenderBase64(pb, cb, m_binaryFormat, pch);
     *pch++ = '"';
     m_renderBuffer.SetEndPointer(pch);
 }
@@ -528,32 +2276,40 @@ void JsonRenderer::RenderUuid(_In_reads_(16) char unsigned const* value)
 void JsonRenderer::RenderString(std::string_view const value)
 {
     WriteChar('"');
-    for (auto ch : value)
+
+    auto pchRun = value.data();
+    auto const pchEnd = pchRun + value.size();
+    for (;;)
     {
+        // Copy the run of characters that need no escaping in one append.
+        auto const pchEscape = FindEscapeChar(pchRun, pchEnd);
+        WriteChars(pchRun, static_cast<unsigned>(pchEscape - pchRun));
+        if (pchEscape == pchEnd)
+        {
+            break;
+        }
+
+        auto const ch = *pchEscape;
+        pchRun = pchEscape + 1;
         if (static_cast<unsigned char>(ch) < 0x20)
         {
             // Control character - must be escaped.
             switch (ch)
             {
             case 8:
-                WriteChar('\\');
-                WriteChar('b');
+                WriteChars("\\b", 2);
                 break;
             case 9:
-                WriteChar('\\');
-                WriteChar('t');
+                WriteChars("\\t", 2);
                 break;
             case 10:
-                WriteChar('\\');
-                WriteChar('n');
+                WriteChars("\\n", 2);
                 break;
             case 12:
-                WriteChar('\\');
-                WriteChar('f');
+                WriteChars("\\f", 2);
                 break;
             case 13:
-                WriteChar('\\');
-                WriteChar('r');
+                WriteChars("\\r", 2);
                 break;
             default:
                 auto p = m_renderBuffer.GetAppendPointer(6);
@@ -566,23 +2322,404 @@ void JsonRenderer::RenderString(std::string_view const value)
                 break;
             }
         }
-        else if (ch == '"' || ch == '\\')
+        else
+        {
+            // Quote or backslash.
+            auto p = m_renderBuffer.GetAppendPointer(2);
+            *p++ = '\\';
+            *p++ = ch;
+            m_renderBuffer.SetEndPointer(p);
+        }
+    }
+
+    WriteChar('"');
+}
+
+// Limits for the rendered-name cache. The table is twice the maximum
+// number of names to keep probe sequences short.
+auto constexpr NameCacheSlots = 2048u;
+auto constexpr NameCacheMaxNames = NameCacheSlots / 2;
+auto constexpr NameCacheMaxData = 65536u;
+
+static unsigned HashName(std::string_view const name) noexcept
+{
+    // FNV-1a.
+    unsigned hash = 2166136261u;
+    for (auto ch : name)
+    {
+        hash = (hash ^ static_cast<unsigned char>(ch)) * 16777619u;
+    }
+    return hash;
+}
+
+void JsonRenderer::RenderName(iterator const& it)
+{
+    auto const name = it->Name();
+    if (it->IsEscapeFree())
+    {
+        // "name": or "name": with a space, in one append.
+        auto const cchSuffix = m_pretty ? 3u : 2u;
+        if (name.size() > RenderBuffer::max_size() - 1u - cchSuffix)
+        {
+            JsonThrowLengthError("JsonRenderer - output too large");
+        }
+
+        auto const cch = static_cast<unsigned>(name.size());
+        auto pch = m_renderBuffer.GetAppendPointer(1u + cch + cchSuffix);
+        *pch++ = '"';
+        memcpy(pch, name.data(), cch);
+        pch += cch;
+        memcpy(pch, "\": ", cchSuffix);
+        pch += cchSuffix;
+        m_renderBuffer.SetEndPointer(pch);
+        return;
+    }
+
+    NameCacheEntry* pSlot = nullptr;
+    unsigned hash = 0;
+    if (m_nameCache)
+    {
+        if (m_nameCacheTable.empty())
+        {
+            m_nameCacheTable.resize(NameCacheSlots);
+            memset(m_nameCacheTable.data(), 0, NameCacheSlots * sizeof(NameCacheEntry));
+        }
+
+        hash = HashName(name);
+        auto const pTable = m_nameCacheTable.data();
+        for (auto i = hash;; i += 1)
+        {
+            auto& slot = pTable[i & (NameCacheSlots - 1)];
+            if (slot.cchToken == 0)
+            {
+                pSlot = &slot; // Not found. Insert here if there is room.
+                break;
+            }
+
+            if (slot.hash == hash &&
+                slot.cchName == name.size() &&
+                0 == memcmp(m_nameCacheData.data() + slot.offset, name.data(), name.size()))
+            {
+                WriteChars(m_nameCacheData.data() + slot.offset + slot.cchName, slot.cchToken);
+                return;
+            }
+        }
+    }
+
+    auto const cchOld = m_renderBuffer.size();
+    RenderString(name);
+    WriteChar(':');
+
+    if (m_pretty)
+    {
+        WriteChar(' ');
+    }
+
+    if (pSlot != nullptr &&
+        m_nameCacheCount < NameCacheMaxNames &&
+        m_nameCacheData.size() + name.size() + (m_renderBuffer.size() - cchOld) <= NameCacheMaxData)
+    {
+        auto const cchToken = m_renderBuffer.size() - cchOld;
+        auto const offset = m_nameCacheData.size();
+        m_nameCacheData.append(name.data(), static_cast<unsigned>(name.size()));
+        m_nameCacheData.append(m_renderBuffer.data() + cchOld, cchToken);
+        pSlot->hash = hash;
+        pSlot->offset = offset;
+        pSlot->cchName = static_cast<unsigned>(name.size());
+        pSlot->cchToken = cchToken;
+        m_nameCacheCount += 1;
+    }
+}
+
+void JsonRenderer::RenderEscapeFreeString(std::string_view const value)
+{
+    if (value.size() > RenderBuffer::max_size() - 2u)
+    {
+        JsonThrowLengthError("JsonRenderer - output too large");
+    }
+
+    auto const cch = static_cast<unsigned>(value.size());
+    auto pch = m_renderBuffer.GetAppendPointer(cch + 2u);
+    *pch++ = '"';
+    memcpy(pch, value.data(), cch);
+    pch += cch;
+    *pch++ = '"';
+    m_renderBuffer.SetEndPointer(pch);
+}
+
+/*
+Returns the number of decimal digits in n (at least 1).
+*/
+static unsigned CountDigits(uint64_t n) noexcept
+{
+    unsigned cch = 1;
+    for (; n >= 10000; n /= 10000)
+    {
+        cch += 4;
+    }
+    return cch + (n >= 10) + (n >= 100) + (n >= 1000);
+}
+
+static size_t MeasureInteger(long long unsigned value) noexcept
+{
+    return CountDigits(value);
+}
+
+static size_t MeasureInteger(long long signed value) noexcept
+{
+    return value < 0
+        ? 1u + CountDigits(0u - static_cast<uint64_t>(value))
+        : CountDigits(static_cast<uint64_t>(value));
+}
+
+/*
+Returns the number of bytes that RenderString(value) would write.
+*/
+static size_t MeasureString(std::string_view const value) noexcept
+{
+    size_t cch = 2 + value.size();
+    auto const pchEnd = value.data() + value.size();
+    for (auto pch = FindEscapeChar(value.data(), pchEnd);
+         pch != pchEnd;
+         pch = FindEscapeChar(pch + 1, pchEnd))
+    {
+        switch (*pch)
+        {
+        case '"':
+        case '\\':
+        case 8:
+        case 9:
+        case 10:
+        case 12:
+        case 13:
+            cch += 1; // e.g. \n
+            break;
+        default:
+            cch += 5; // \u00XX
+            break;
+        }
+    }
+    return cch;
+}
+
+size_t JsonRenderer::MeasureValue(iterator const& it)
+{
+    assert(!it.IsRoot());
+    char buffer[40];
+    switch (it->Type())
+    {
+    case JsonObject:
+        return MeasureStructure(it, true);
+    case JsonArray:
+        return MeasureStructure(it, false);
+    case JsonNull:
+        return 4;
+    case JsonBool:
+        return it->GetUnchecked<bool>() ? 4 : 5;
+    case JsonUtf8:
+        return it->IsEscapeFree()
+            ? 2 + it->GetUnchecked<std::string_view>().size()
+            : MeasureString(it->GetUnchecked<std::string_view>());
+    case JsonFloat:
+        return JsonRenderFloat(it->GetUnchecked<double>(), m_floatFormat, m_floatPrecision, buffer);
+    case JsonInt:
+        return MeasureInteger(it->GetUnchecked<long long signed>());
+    case JsonUInt:
+        return MeasureInteger(it->GetUnchecked<long long unsigned>());
+    case JsonTime:
+        return JsonRenderTime(it->GetUnchecked<TimeStruct>(), m_timeFormat, buffer) +
+            (TimeFormatIsString(m_timeFormat) ? 2u : 0u);
+    case JsonDecimal:
+        return JsonRenderDecimal(it->GetUnchecked<DecimalStruct>(), buffer);
+    case JsonUuid:
+        return m_uuidFormat == JsonUuidUppercaseCompact || m_uuidFormat == JsonUuidLowercaseCompact
+            ? 2 + 32
+            : 2 + 36;
+    case JsonInt32Array:
+        return MeasurePackedArray<int32_t>(it);
+    case JsonInt64Array:
+        return MeasurePackedArray<int64_t>(it);
+    case JsonUInt32Array:
+        return MeasurePackedArray<uint32_t>(it);
+    case JsonUInt64Array:
+        return MeasurePackedArray<uint64_t>(it);
+    case JsonFloatArray:
+        return MeasurePackedArray<float>(it);
+    case JsonDoubleArray:
+        return MeasurePackedArray<double>(it);
+    case JsonBinary: {
+        size_t const cb = it->DataSize();
+        return m_binaryFormat == JsonBinaryBase64
+            ? 2 + 4 * ((cb + 2) / 3)
+            : 2 + (cb * 4 + 2) / 3;
+    }
+    default: {
+        // Custom types can only be measured by rendering them.
+        auto const cchOld = m_renderBuffer.size();
+        RenderCustomValue(it);
+        auto const cch = m_renderBuffer.size() - cchOld;
+        m_renderBuffer.resize(cchOld);
+        return cch;
+    }
+    }
+}
+
+size_t JsonRenderer::MeasureStructure(iterator const& itParent, bool showNames)
+{
+    m_structures.clear();
+
+    size_t cch = 2; // Braces.
+    if (!PushStructure(itParent, showNames))
+    {
+        return cch;
+    }
+
+    m_indent += m_indentSpaces;
+
+    for (;;)
+    {
+        auto& frame = m_structures[m_structures.size() - 1];
+        if (frame.it == frame.itEnd)
+        {
+            m_structures.resize(m_structures.size() - 1);
+            m_indent -= m_indentSpaces;
+
+            if (m_pretty)
+            {
+                cch += m_newLine.size() + m_indent;
+            }
+
+            if (m_structures.empty())
+            {
+                break;
+            }
+
+            continue;
+        }
+
+        auto const it = frame.it;
+        ++frame.it;
+
+        if (!frame.first)
+        {
+            cch += 1; // Comma.
+        }
+        frame.first = false;
+
+        if (m_pretty)
+        {
+            cch += m_newLine.size() + m_indent;
+        }
+
+        if (frame.showNames)
+        {
+            cch += it->IsEscapeFree()
+                ? 2 + it->Name().size()
+                : MeasureString(it->Name());
+            cch += m_pretty ? 2 : 1; // ':' or ": "
+        }
+
+        auto const type = it->Type();
+        if (type == JsonObject || type == JsonArray)
         {
-            // ASCII character - pass through (escape quote and backslash)
-            WriteChar('\\');
-            WriteChar(ch);
+            cch += 2; // Braces.
+            if (PushStructure(it, type == JsonObject))
+            {
+                m_indent += m_indentSpaces;
+            }
         }
         else
         {
-            WriteChar(ch);
+            cch += MeasureValue(it);
         }
     }
-    WriteChar('"');
+
+    return cch;
+}
+
+template<class T>
+size_t JsonRenderer::MeasurePackedArray(iterator const& it)
+{
+    unsigned cbData;
+    auto const pbData = static_cast<char unsigned const*>(it->Data(&cbData));
+    size_t const cElements = cbData / sizeof(T);
+
+    size_t cch = 2; // Brackets.
+    if (cElements != 0)
+    {
+        cch += cElements - 1; // Commas.
+        if (m_pretty)
+        {
+            cch += cElements * (m_newLine.size() + m_indent + m_indentSpaces);
+            cch += m_newLine.size() + m_indent;
+        }
+
+        for (size_t iElement = 0; iElement != cElements; iElement += 1)
+        {
+            T value;
+            memcpy(&value, pbData + iElement * sizeof(T), sizeof(T));
+            if constexpr (std::is_floating_point_v<T>)
+            {
+                char buffer[32];
+                cch += RenderPackedElement(value, m_floatFormat, m_floatPrecision, buffer);
+            }
+            else if constexpr (std::is_signed_v<T>)
+            {
+                cch += MeasureInteger(static_cast<long long signed>(value));
+            }
+            else
+            {
+                cch += MeasureInteger(static_cast<long long unsigned>(value));
+            }
+        }
+    }
+
+    return cch;
+}
+
+void JsonRenderer::FlushChunks()
+{
+    auto const cch = m_renderBuffer.size();
+    if (m_sink == nullptr || cch < m_chunkSize)
+    {
+        return;
+    }
+
+    auto const pch = m_renderBuffer.data();
+    size_type iChunk = 0;
+    for (; cch - iChunk >= m_chunkSize; iChunk += m_chunkSize)
+    {
+        m_sink->Write(std::string_view(pch + iChunk, m_chunkSize));
+    }
+
+    memmove(pch, pch + iChunk, cch - iChunk);
+    m_renderBuffer.resize(cch - iChunk);
+}
+
+std::string_view JsonRenderer::NewLineIndent()
+{
+    auto const cch = m_newLine.size() + m_indent;
+    if (m_newLineIndent.size() < cch)
+    {
+        // Build a few levels deeper than needed so that nesting does not
+        // rebuild the string at every level.
+        auto const cchIndent = m_indent + 8u * m_indentSpaces;
+        if (cchIndent < m_indent || cchIndent > RenderBuffer::max_size() - m_newLine.size())
+        {
+            JsonThrowLengthError("JsonRenderer - output too large");
+        }
+
+        m_newLineIndent.clear();
+        m_newLineIndent.append(m_newLine.data(), static_cast<unsigned>(m_newLine.size()));
+        m_newLineIndent.append(cchIndent, m_indentChar);
+    }
+
+    return std::string_view(m_newLineIndent.data(), cch);
 }
 
 void JsonRenderer::RenderNewline()
 {
-    WriteChars(m_newLine.data(), static_cast<unsigned>(m_newLine.size()));
-    m_renderBuffer.append(m_indent, ' ');
+    auto const newLineIndent = NewLineIndent();
+    WriteChars(newLineIndent.data(), static_cast<unsigned>(newLineIndent.size()));
 }
 }  // namespace jsonbuilder
@@ -4,6 +4,7 @@
 #include <catch2/catch.hpp>
 #include <jsonbuilder/JsonBuilder.h>
 #include <string.h>
+#include <stdexcept>
 
 #define USTRING(prefix) prefix ## "\u0024\u00A3\u0418\u0939\u20AC\uD55C\U00010348"
 #define CHAR_USTRING() reinterpret_cast<char const*>(USTRING(u8))
@@ -21,6 +22,54 @@ static void uuid_generate(uuid_t uuid)
 #include <uuid/uuid.h>
 #endif
 
+namespace
+{
+    struct ReflectPoint
+    {
+        int x;
+        double y;
+    };
+
+    struct ReflectEvent
+    {
+        unsigned id;
+        std::string message;
+        std::optional<ReflectPoint> where;
+        std::vector<ReflectPoint> path;
+    };
+
+    // Stored as null. Records the builder's buffer capacity when added.
+    struct CapacityProbe
+    {
+        std::vector<size_t>* capacities;
+    };
+
+    struct ReflectProbes
+    {
+        CapacityProbe first;
+        std::vector<CapacityProbe> items;
+        CapacityProbe last;
+    };
+}
+
+JSONBUILDER_REFLECT(ReflectPoint, x, y)
+JSONBUILDER_REFLECT(ReflectEvent, id, message, where, path)
+
+template<>
+class jsonbuilder::JsonImplementType<CapacityProbe>
+{
+public:
+
+    static JsonIterator
+    AddValueCommit(JsonBuilder& builder, CapacityProbe const& data)
+    {
+        data.capacities->push_back(builder.buffer_capacity());
+        return builder._newValueCommit(JsonNull, 0, nullptr);
+    }
+};
+
+JSONBUILDER_REFLECT(ReflectProbes, first, items, last)
+
 using namespace jsonbuilder;
 
 auto constexpr TicksPerSecond = 10'000'000u;
@@ -210,6 +259,50 @@ TEST_CASE("JsonBuilder numeric limits", "[builder]")
     SECTION("double") { TestInputOutputScalar<double, double>(); }
 }
 
+TEST_CASE("JsonBuilder CompactIntegers", "[builder]")
+{
+    JsonBuilder b;
+    REQUIRE(!b.CompactIntegers());
+    REQUIRE(b.push_back(b.root(), "", 7ull)->DataSize() == 8);
+    REQUIRE(b.push_back(b.root(), "", 7)->DataSize() == sizeof(int));
+
+    b.CompactIntegers(true);
+    REQUIRE(b.CompactIntegers());
+
+    auto check = [&](auto value, unsigned cbExpected, JsonType typeExpected)
+    {
+        using T = decltype(value);
+        auto itr = b.push_back(b.root(), "", value);
+        REQUIRE(itr->Type() == typeExpected);
+        REQUIRE(itr->DataSize() == cbExpected);
+        REQUIRE(itr->template GetUnchecked<T>() == value);
+        T converted{};
+        REQUIRE(itr->ConvertTo(converted));
+        REQUIRE(converted == value);
+    };
+
+    check(0ull, 1, JsonUInt);
+    check(255ull, 1, JsonUInt);
+    check(256ull, 2, JsonUInt);
+    check(65535u, 2, JsonUInt);
+    check(65536ul, 4, JsonUInt);
+    check(4294967295ull, 4, JsonUInt);
+    check(4294967296ull, 8, JsonUInt);
+    check(std::numeric_limits<uint64_t>::max(), 8, JsonUInt);
+
+    check(0ll, 1, JsonInt);
+    check(-128ll, 1, JsonInt);
+    check(127, 1, JsonInt);
+    check(-129ll, 2, JsonInt);
+    check(static_cast<short>(-32768), 2, JsonInt);
+    check(32768l, 4, JsonInt);
+    check(std::numeric_limits<int32_t>::min(), 4, JsonInt);
+    check(std::numeric_limits<int64_t>::min(), 8, JsonInt);
+    check(std::numeric_limits<int64_t>::max(), 8, JsonInt);
+
+    REQUIRE_NOTHROW(b.ValidateData());
+}
+
 TEST_CASE("JsonBuilder internal name realloc")
 {
     JsonBuilder b;
@@ -475,6 +568,526 @@ TEST_CASE("JsonBuilder uuid push_back", "[builder]")
     REQUIRE(memcmp(retrieved.Data, uuid.Data, sizeof(uuid.Data)) == 0);
 }
 
+TEST_CASE("JsonBuilder decimal push_back", "[builder]")
+{
+    JsonBuilder b;
+    auto itr = b.push_back(b.root(), "Price", DecimalStruct::FromValue(-12345, 2));
+    REQUIRE(itr->Type() == JsonDecimal);
+
+    auto retrieved = itr->GetUnchecked<DecimalStruct>();
+    REQUIRE(retrieved.Mantissa() == -12345);
+    REQUIRE(retrieved.Scale == 2);
+
+    double fval;
+    REQUIRE((itr->ConvertTo(fval) && fval == -123.45));
+
+    itr = b.push_back(b.root(), "Tiny", DecimalStruct::FromValue(INT64_MIN, 40));
+    REQUIRE(itr->GetUnchecked<DecimalStruct>().Mantissa() == INT64_MIN);
+    REQUIRE(itr->ConvertTo(fval));
+    REQUIRE(fval == Approx(-9.223372036854775808e-22));
+
+    DecimalStruct dval;
+    itr = b.push_back(b.root(), "Int", -7);
+    REQUIRE((itr->ConvertTo(dval) && dval.Mantissa() == -7 && dval.Scale == 0));
+    itr = b.push_back(b.root(), "Huge", UINT64_MAX);
+    REQUIRE(!itr->ConvertTo(dval));
+    itr = b.push_back(b.root(), "Float", 1.5);
+    REQUIRE(!itr->ConvertTo(dval));
+}
+
+TEST_CASE("JsonBuilder packed array push_back", "[builder]")
+{
+    JsonBuilder b;
+
+    double const doubles[] = { 1.5, -2, 3e100 };
+    auto itDoubles = b.push_back(b.root(), "doubles", std::span(doubles));
+    REQUIRE(itDoubles->Type() == JsonDoubleArray);
+    REQUIRE(itDoubles->DataSize() == sizeof(doubles));
+
+    int32_t const ints[] = { -1, 0, 2147483647 };
+    auto itInts = b.push_back(b.root(), "ints", std::span<int32_t const>(ints));
+    REQUIRE(itInts->Type() == JsonInt32Array);
+
+    auto retrieved = itDoubles->GetUnchecked<std::span<double const>>();
+    REQUIRE(retrieved.size() == 3);
+    REQUIRE(memcmp(retrieved.data(), doubles, sizeof(doubles)) == 0);
+
+    std::span<int32_t const> intsVal;
+    std::span<uint32_t const> uintsVal;
+    REQUIRE(itInts->ConvertTo(intsVal));
+    REQUIRE(intsVal.size() == 3);
+    REQUIRE(intsVal[2] == 2147483647);
+    REQUIRE(!itInts->ConvertTo(uintsVal));
+    REQUIRE(!itDoubles->ConvertTo(intsVal));
+
+    auto itEmpty = b.push_back(b.root(), "empty", std::span<uint64_t const>());
+    REQUIRE(itEmpty->Type() == JsonUInt64Array);
+    REQUIRE(itEmpty->DataSize() == 0);
+
+    REQUIRE_NOTHROW(b.ValidateData());
+}
+
+// Requires that the children of itA and itB have the same types, names, and
+// data, recursively.
+static void RequireSameValues(
+    JsonBuilder const& a,
+    JsonBuilder::const_iterator const& itA,
+    JsonBuilder const& b,
+    JsonBuilder::const_iterator const& itB)
+{
+    auto childA = a.begin(itA);
+    auto childB = b.begin(itB);
+    for (; childA != a.end(itA) && childB != b.end(itB); ++childA, ++childB)
+    {
+        REQUIRE(childA->Type() == childB->Type());
+        REQUIRE(childA->Name() == childB->Name());
+        if (childA->Type() == JsonArray || childA->Type() == JsonObject)
+        {
+            RequireSameValues(a, childA, b, childB);
+        }
+        else
+        {
+            REQUIRE(childA->DataSize() == childB->DataSize());
+            REQUIRE(memcmp(childA->Data(), childB->Data(), childA->DataSize()) == 0);
+        }
+    }
+
+    REQUIRE(childA == a.end(itA));
+    REQUIRE(childB == b.end(itB));
+}
+
+TEST_CASE("JsonBuilder JSONBUILDER_REFLECT push_back", "[builder]")
+{
+    ReflectEvent const event = { 7u, "hello", ReflectPoint{ 1, 2.5 }, { { 3, 4 }, { 5, 6 } } };
+
+    JsonBuilder b;
+    auto itEvent = b.push_back(b.root(), "event", event);
+    REQUIRE(itEvent->Type() == JsonObject);
+    REQUIRE(b.count(itEvent) == 4);
+    REQUIRE(b.find(itEvent, "id")->GetUnchecked<unsigned>() == 7u);
+    REQUIRE(b.find(itEvent, "message")->GetUnchecked<std::string_view>() == "hello");
+    REQUIRE(b.find(itEvent, "where", "x")->GetUnchecked<int>() == 1);
+    REQUIRE(b.find(itEvent, "where", "y")->GetUnchecked<double>() == 2.5);
+    REQUIRE(b.count(b.find(itEvent, "path")) == 2);
+    REQUIRE(b.find(itEvent, "path").begin()->Type() == JsonObject);
+    REQUIRE_NOTHROW(b.ValidateData());
+
+    SECTION("Same storage as individual push_back calls")
+    {
+        JsonBuilder expected;
+        auto it = expected.push_back(expected.root(), "event", JsonObject);
+        expected.push_back(it, "id", 7u);
+        expected.push_back(it, "message", "hello");
+        auto itWhere = expected.push_back(it, "where", JsonObject);
+        expected.push_back(itWhere, "x", 1);
+        expected.push_back(itWhere, "y", 2.5);
+        auto itPath = expected.push_back(it, "path", JsonArray);
+        for (auto const& point : event.path)
+        {
+            auto itPoint = expected.push_back(itPath, "", JsonObject);
+            expected.push_back(itPoint, "x", point.x);
+            expected.push_back(itPoint, "y", point.y);
+        }
+
+        REQUIRE(b.buffer_size() == expected.buffer_size());
+        RequireSameValues(b, b.root(), expected, expected.root());
+    }
+
+    SECTION("Storage is reserved once")
+    {
+        std::vector<size_t> capacities;
+        CapacityProbe const probe = { &capacities };
+        ReflectProbes const probes = { probe, std::vector<CapacityProbe>(100, probe), probe };
+
+        JsonBuilder reserved;
+        reserved.push_back(reserved.root(), "first", 0);
+        capacities.push_back(reserved.buffer_capacity());
+        auto itProbes = reserved.push_back(reserved.root(), "probes", probes);
+        capacities.push_back(reserved.buffer_capacity());
+        REQUIRE(reserved.count(itProbes) == 3);
+        REQUIRE(reserved.count(reserved.find(itProbes, "items")) == 100);
+
+        // Capacity before, at each probe, and after: changes at most once.
+        REQUIRE(capacities.size() == 2 + 102);
+        unsigned changes = 0;
+        for (size_t i = 1; i != capacities.size(); i += 1)
+        {
+            changes += capacities[i] != capacities[i - 1];
+        }
+        REQUIRE(changes <= 1);
+    }
+
+    SECTION("Empty optional")
+    {
+        ReflectEvent const empty = {};
+        auto itEmpty = b.push_back(b.root(), "empty", empty);
+        REQUIRE(b.find(itEmpty, "where")->IsNull());
+        REQUIRE(b.count(b.find(itEmpty, "path")) == 0);
+    }
+}
+
+TEST_CASE("JsonBuilder binary push_back", "[builder]")
+{
+    std::byte const bytes[] = { std::byte{ 1 }, std::byte{ 2 }, std::byte{ 3 } };
+
+    JsonBuilder b;
+    auto itr = b.push_back(b.root(), "bin", std::span(bytes));
+    REQUIRE(itr->Type() == JsonBinary);
+
+    auto retrieved = itr->GetUnchecked<std::span<std::byte const>>();
+    REQUIRE(retrieved.size() == 3);
+    REQUIRE(memcmp(retrieved.data(), bytes, sizeof(bytes)) == 0);
+
+    std::span<std::byte const> converted;
+    REQUIRE(itr->ConvertTo(converted));
+    REQUIRE(converted.size() == 3);
+    REQUIRE(!b.push_back(b.root(), "n", 1)->ConvertTo(converted));
+    REQUIRE(converted.empty());
+}
+
+TEST_CASE("JsonBuilder container push_back", "[builder]")
+{
+    JsonBuilder b;
+
+    SECTION("optional")
+    {
+        auto itSome = b.push_back(b.root(), "some", std::optional<int>(5));
+        auto itNone = b.push_back(b.root(), "none", std::optional<int>());
+        REQUIRE(itSome->Type() == JsonInt);
+        REQUIRE(itNone->Type() == JsonNull);
+
+        REQUIRE(itSome->GetUnchecked<std::optional<int>>() == 5);
+        REQUIRE(!itNone->GetUnchecked<std::optional<int>>().has_value());
+
+        std::optional<int> converted = 1;
+        REQUIRE(itNone->ConvertTo(converted));
+        REQUIRE(!converted.has_value());
+        REQUIRE(itSome->ConvertTo(converted));
+        REQUIRE(converted == 5);
+        REQUIRE(!b.push_back(b.root(), "s", "x")->ConvertTo(converted));
+        REQUIRE(!converted.has_value());
+    }
+
+    SECTION("vector")
+    {
+        std::vector<std::string> const names = { "a", "bc", std::string(100, 'd') };
+        auto itNames = b.push_back(b.root(), "names", names);
+        REQUIRE(itNames->Type() == JsonArray);
+        REQUIRE(b.count(itNames) == 3);
+
+        auto itName = itNames.begin();
+        for (auto const& name : names)
+        {
+            REQUIRE(itName->Name().empty());
+            REQUIRE(itName->GetUnchecked<std::string_view>() == name);
+            ++itName;
+        }
+        REQUIRE(itName == itNames.end());
+
+        auto itEmpty = b.push_back(b.root(), "empty", std::vector<int>());
+        REQUIRE(itEmpty->Type() == JsonArray);
+        REQUIRE(b.count(itEmpty) == 0);
+
+        auto itBools = b.push_back(b.root(), "bools", std::vector<bool>{ true, false });
+        REQUIRE(itBools.begin()->GetUnchecked<bool>());
+    }
+
+    SECTION("Nested containers use one reservation")
+    {
+        std::vector<size_t> capacities;
+        std::vector<std::vector<CapacityProbe>> const rows(
+            50, std::vector<CapacityProbe>(20, CapacityProbe{ &capacities }));
+        b.push_back(b.root(), "warmup", 0);
+        capacities.push_back(b.buffer_capacity());
+
+        auto itRows = b.push_back(b.root(), "rows", rows);
+        capacities.push_back(b.buffer_capacity());
+        REQUIRE(b.count(itRows) == 50);
+        REQUIRE(b.count(itRows.begin()) == 20);
+        REQUIRE(itRows.begin().begin()->IsNull());
+
+        // Capacity before, at each element, and after: changes at most once.
+        REQUIRE(capacities.size() == 2 + 50 * 20);
+        unsigned changes = 0;
+        for (size_t i = 1; i != capacities.size(); i += 1)
+        {
+            changes += capacities[i] != capacities[i - 1];
+        }
+        REQUIRE(changes <= 1);
+    }
+
+    SECTION("map")
+    {
+        std::map<std::string, std::optional<double>> const values = {
+            { "x", 1.5 },
+            { "y", std::nullopt },
+        };
+        auto itValues = b.push_back(b.root(), "values", values);
+        REQUIRE(itValues->Type() == JsonObject);
+        REQUIRE(b.find(itValues, "x")->GetUnchecked<double>() == 1.5);
+        REQUIRE(b.find(itValues, "y")->IsNull());
+
+        std::array<std::map<std::string_view, int>, 2> const maps = {};
+        auto itMaps = b.push_back(b.root(), "maps", maps);
+        REQUIRE(b.count(itMaps) == 2);
+        REQUIRE(itMaps.begin()->Type() == JsonObject);
+    }
+
+    SECTION("span")
+    {
+        std::string_view const strings[] = { "x", "y" };
+        auto itStrings = b.push_back(b.root(), "strings", std::span(strings));
+        REQUIRE(itStrings->Type() == JsonArray);
+        REQUIRE(b.count(itStrings) == 2);
+    }
+
+    REQUIRE_NOTHROW(b.ValidateData());
+}
+
+TEST_CASE("JsonBuilder emplace", "[builder]")
+{
+    JsonBuilder b;
+
+    SECTION("emplace_back pointer callback")
+    {
+        auto itr = b.emplace_back(b.root(), "str", JsonUtf8, 100,
+            [](void* pb, unsigned cb)
+            {
+                REQUIRE(cb == 100);
+                memcpy(pb, "hello", 5);
+                return 5u;
+            });
+        REQUIRE(itr->Type() == JsonUtf8);
+        REQUIRE(itr->GetUnchecked<std::string_view>() == "hello");
+
+        // Unused payload storage was released.
+        JsonBuilder b2;
+        b2.push_back(b2.root(), "str", "hello");
+        REQUIRE(b.buffer_size() == b2.buffer_size());
+        REQUIRE_NOTHROW(b.ValidateData());
+    }
+
+    SECTION("emplace_front span callback")
+    {
+        b.push_back(b.root(), "second", 2);
+        auto itr = b.emplace_front(b.root(), u"first", JsonUtf8, 8,
+            [](std::span<std::byte> data)
+            {
+                data[0] = std::byte{ 'x' };
+                return size_t{ 1 };
+            });
+        REQUIRE(b.begin() == itr);
+        REQUIRE(itr->Name() == "first");
+        REQUIRE(itr->GetUnchecked<std::string_view>() == "x");
+        REQUIRE_NOTHROW(b.ValidateData());
+    }
+
+    SECTION("emplace_back callback throws")
+    {
+        b.push_back(b.root(), "before", 1);
+        REQUIRE_THROWS_AS(
+            b.emplace_back(b.root(), "bad", JsonUtf8, 1000,
+                [](void*, unsigned) -> unsigned { throw std::invalid_argument("fill"); }),
+            std::invalid_argument);
+        REQUIRE(b.find("bad") == b.end());
+        REQUIRE(std::distance(b.begin(), b.end()) == 1);
+        REQUIRE_NOTHROW(b.ValidateData());
+    }
+}
+
+TEST_CASE("JsonBuilder append_to_last", "[builder]")
+{
+    JsonBuilder b;
+    b.push_back(b.root(), "first", "abc");
+    auto itr = b.push_back(b.root(), "message", "Prefix");
+
+    REQUIRE(b.append_to_last(": ") == itr);
+    b.append_to_last(std::string("utf8 "));
+    b.append_to_last(u"utf16 ");
+    b.append_to_last(U"utf32 ");
+    b.append_to_last(L"wide ");
+    b.append_to_last(USTRING(u));
+    REQUIRE(itr->GetUnchecked<std::string_view>() ==
+        std::string("Prefix: utf8 utf16 utf32 wide ") + CHAR_USTRING());
+
+    SECTION("Self-append across reallocation")
+    {
+        b.append_to_last(std::string(1000, 'x'));
+        auto const before = std::string(itr->GetUnchecked<std::string_view>());
+        b.append_to_last(itr->GetUnchecked<std::string_view>());
+        REQUIRE(itr->GetUnchecked<std::string_view>() == before + before);
+    }
+
+    SECTION("Append after ReduceDataSize")
+    {
+        itr->ReduceDataSize(3);
+        b.append_to_last("-suffix");
+        REQUIRE(itr->GetUnchecked<std::string_view>() == "Pre-suffix");
+    }
+
+    SECTION("Storage matches push_back of the whole string")
+    {
+        JsonBuilder b2;
+        b2.push_back(b2.root(), "first", "abc");
+        b2.push_back(b2.root(), "message", itr->GetUnchecked<std::string_view>());
+        REQUIRE(b.buffer_size() == b2.buffer_size());
+    }
+
+    REQUIRE(b.begin()->GetUnchecked<std::string_view>() == "abc");
+    REQUIRE_NOTHROW(b.ValidateData());
+}
+
+TEST_CASE("JsonBuilder IsEscapeFree", "[builder]")
+{
+    JsonBuilder b;
+
+    REQUIRE(b.push_back(b.root(), "name", "value")->IsEscapeFree());
+    REQUIRE(b.push_back(b.root(), "name", 5)->IsEscapeFree());
+    REQUIRE(b.push_back(b.root(), "obj", JsonObject)->IsEscapeFree());
+    REQUIRE(b.push_back(b.root(), u"name", u"\u00E9t\u00E9")->IsEscapeFree());
+    REQUIRE(b.push_back(b.root(), "name", latin1_view("caf\xE9"))->IsEscapeFree());
+    REQUIRE(!b.push_back(b.root(), "na\"me", 5)->IsEscapeFree());
+    REQUIRE(!b.push_back(b.root(), "name", "line\n")->IsEscapeFree());
+    REQUIRE(!b.push_back(b.root(), "name", U"back\\slash")->IsEscapeFree());
+    REQUIRE(!b.push_back(b.root(), "\t", JsonArray)->IsEscapeFree());
+
+    SECTION("append_to_last")
+    {
+        b.push_back(b.root(), "name", "value");
+        REQUIRE(b.append_to_last(" more")->IsEscapeFree());
+        REQUIRE(!b.append_to_last(u"\"")->IsEscapeFree());
+        REQUIRE(!b.append_to_last("ok")->IsEscapeFree());
+    }
+
+    SECTION("Mutable Data clears the flag")
+    {
+        auto itr = b.push_back(b.root(), "name", "value");
+        static_cast<JsonValue const&>(*itr).Data();
+        REQUIRE(itr->IsEscapeFree());
+        itr->Data();
+        REQUIRE(!itr->IsEscapeFree());
+    }
+
+    SECTION("Emplaced strings are not escape-free")
+    {
+        auto itr = b.emplace_back(b.root(), "name", JsonUtf8, 4,
+            [](void* pb, unsigned) { memcpy(pb, "text", 4); return 4u; });
+        REQUIRE(!itr->IsEscapeFree());
+    }
+
+    SECTION("ValidateData rejects an incorrect flag")
+    {
+        JsonBuilder bad;
+        auto itr = bad.push_back(bad.root(), "name", "a\"b");
+        REQUIRE(!itr->IsEscapeFree());
+
+        std::vector<char unsigned> raw(
+            static_cast<char unsigned const*>(bad.buffer_data()),
+            static_cast<char unsigned const*>(bad.buffer_data()) + bad.buffer_size());
+        auto const valueOffset =
+            reinterpret_cast<char unsigned const*>(&*itr) -
+            static_cast<char unsigned const*>(bad.buffer_data());
+        REQUIRE_NOTHROW(JsonBuilder(raw.data(), raw.size()));
+        raw[valueOffset + 6] |= 0x80; // Set m_escapeFree.
+        REQUIRE_THROWS_AS(JsonBuilder(raw.data(), raw.size()), std::invalid_argument);
+    }
+
+    REQUIRE_NOTHROW(b.ValidateData());
+}
+
+TEST_CASE("JsonBuilder JsonTemplate", "[builder]")
+{
+    JsonBuilder prototype;
+    prototype.push_back(prototype.root(), "name", "event");
+    prototype.push_back(prototype.root(), "time", TimeStruct::FromValue(0));
+    auto itDevice = prototype.push_back(prototype.root(), "device", JsonObject);
+    prototype.push_back(itDevice, "id", 0u);
+    prototype.push_back(itDevice, "load", 0.0);
+    prototype.push_back(prototype.root(), "data", JsonObject);
+
+    JsonTemplate tmpl(prototype);
+    auto const slotTime = tmpl.slot("time");
+    auto const slotId = tmpl.slot("device", "id");
+    auto const slotLoad = tmpl.slot("device", "load");
+    auto const slotData = tmpl.slot("data");
+    REQUIRE(slotTime);
+    REQUIRE(slotId);
+    REQUIRE(slotLoad);
+    REQUIRE(slotData);
+    REQUIRE(!tmpl.slot("missing"));
+    REQUIRE(!JsonTemplate::Slot());
+
+    JsonBuilder b;
+    for (unsigned i = 0; i != 3; i += 1)
+    {
+        tmpl.instantiate(b);
+        tmpl.store(b, slotTime, TimeStruct::FromValue(1000 + i));
+        tmpl.store(b, slotId, i);
+        tmpl.store(b, slotLoad, i * 0.5);
+        b.push_back(tmpl.at(b, slotData), "message", "hello");
+        b.push_back(tmpl.at(b, slotData), "index", i);
+        REQUIRE_NOTHROW(b.ValidateData());
+
+        REQUIRE(b.find("name")->GetUnchecked<std::string_view>() == "event");
+        REQUIRE(b.find("time")->GetUnchecked<TimeStruct>().Value() == 1000 + i);
+        REQUIRE(b.find("device", "id")->GetUnchecked<unsigned>() == i);
+        REQUIRE(b.find("device", "load")->GetUnchecked<double>() == i * 0.5);
+        REQUIRE(b.find("data", "message")->GetUnchecked<std::string_view>() == "hello");
+        REQUIRE(b.find("data", "index")->GetUnchecked<unsigned>() == i);
+        REQUIRE(std::distance(b.begin(tmpl.at(b, slotData)), b.end(tmpl.at(b, slotData))) == 2);
+    }
+
+    // Prototype is unchanged.
+    auto copy = tmpl.instantiate();
+    REQUIRE(copy.find("device", "id")->GetUnchecked<unsigned>() == 0);
+    REQUIRE(copy.begin(tmpl.at(copy, slotData)) == copy.end(tmpl.at(copy, slotData)));
+    REQUIRE(tmpl.prototype().buffer_size() == copy.buffer_size());
+}
+
+TEST_CASE("JsonBuilder JsonTemplate CompactIntegers", "[builder]")
+{
+    JsonBuilder prototype;
+    prototype.CompactIntegers(true);
+    prototype.push_back(prototype.root(), "u", 0u);
+    prototype.push_back(prototype.root(), "i", 0);
+    prototype.push_back(prototype.root(), "wide", 0x10000ull);
+
+    JsonTemplate tmpl(prototype);
+    auto const slotU = tmpl.slot("u");
+    auto const slotI = tmpl.slot("i");
+    auto const slotWide = tmpl.slot("wide");
+    REQUIRE(tmpl.prototype().find("u")->DataSize() == 1);
+    REQUIRE(tmpl.prototype().find("i")->DataSize() == 1);
+    REQUIRE(tmpl.prototype().find("wide")->DataSize() == 4);
+
+    JsonBuilder b;
+    tmpl.instantiate(b);
+    tmpl.store(b, slotU, 5u);
+    tmpl.store(b, slotI, -5);
+    tmpl.store(b, slotWide, static_cast<uint16_t>(7));
+    REQUIRE_NOTHROW(b.ValidateData());
+
+    REQUIRE(b.find("u")->DataSize() == 1);
+    REQUIRE(b.find("u")->GetUnchecked<unsigned>() == 5u);
+    REQUIRE(b.find("i")->DataSize() == 1);
+    REQUIRE(b.find("i")->GetUnchecked<int>() == -5);
+    REQUIRE(b.find("wide")->DataSize() == 4);
+    REQUIRE(b.find("wide")->GetUnchecked<uint64_t>() == 7u);
+
+    tmpl.store(b, slotU, uint64_t(255));
+    tmpl.store(b, slotI, int64_t(-128));
+    tmpl.store(b, slotWide, 4294967295ull);
+    REQUIRE(b.find("u")->GetUnchecked<unsigned>() == 255u);
+    REQUIRE(b.find("i")->GetUnchecked<int>() == -128);
+    REQUIRE(b.find("wide")->GetUnchecked<uint64_t>() == 4294967295ull);
+
+    // Same width, different signedness: converted and range-checked.
+    tmpl.store(b, slotWide, int32_t(0x7FFFFFFF));
+    tmpl.store(b, slotI, uint8_t(127));
+    REQUIRE(b.find("wide")->GetUnchecked<uint64_t>() == 0x7FFFFFFFu);
+    REQUIRE(b.find("i")->GetUnchecked<int>() == 127);
+}
+
 TEST_CASE("JsonBuilder find", "[builder]")
 {
     JsonBuilder b;
@@ -552,6 +1165,100 @@ TEST_CASE("JsonBuilder constructors", "[builder]")
     }
 }
 
+TEST_CASE("JsonBuilder TrackChanges", "[builder]")
+{
+    JsonBuilder b;
+    auto itObj = b.push_back(b.root(), "obj", JsonObject);
+    auto itA = b.push_back(itObj, "a", 1);
+    REQUIRE(!b.TrackChanges());
+    REQUIRE(b.ChangeCount() == 0);
+    REQUIRE(!b.ForEachChangeSince(0, [](JsonBuilder::const_iterator const&) {}));
+
+    b.TrackChanges(true);
+    REQUIRE(b.TrackChanges());
+    auto const start = b.ChangeCount();
+    REQUIRE(start != 0);
+
+    std::vector<JsonBuilder::const_iterator> changes;
+    auto const collect = [&](JsonBuilder::const_iterator const& it) { changes.push_back(it); };
+    REQUIRE(b.ForEachChangeSince(start, collect));
+    REQUIRE(changes.empty());
+
+    SECTION("Recorded changes")
+    {
+        b.push_back(itObj, "b", 2);
+        b.push_back(b.root(), "c", 3);
+        *static_cast<int*>(b.MutableData(itA)) = 5;
+        auto itArr = b.push_back(b.root(), "arr", JsonArray);
+        b.splice_back(itObj, itArr);
+        b.erase(itA);
+
+        REQUIRE(b.ForEachChangeSince(start, collect));
+        REQUIRE(changes.size() == 7);
+        REQUIRE(changes[0] == itObj);
+        REQUIRE(changes[1].IsRoot());
+        REQUIRE(changes[2] == itA);
+        REQUIRE(changes[3].IsRoot());
+        REQUIRE(changes[4] == itObj);
+        REQUIRE(changes[5] == itArr);
+        REQUIRE(changes[6] == itA);
+
+        auto const count = b.ChangeCount();
+        REQUIRE(count == start + 7);
+        changes.clear();
+        REQUIRE(b.ForEachChangeSince(count, collect));
+        REQUIRE(changes.empty());
+
+        // Reading through an iterator is not a change.
+        REQUIRE(b.find("c")->GetUnchecked<int>() == 3);
+        REQUIRE(itObj->Type() == JsonObject);
+        REQUIRE(b.ChangeCount() == count);
+
+        // JsonTemplate::store records the stored value.
+        JsonTemplate tmpl(b);
+        tmpl.instantiate(b);
+        auto const instantiated = b.ChangeCount();
+        tmpl.store(b, tmpl.slot("c"), 4);
+        REQUIRE(b.ChangeCount() == instantiated + 1);
+        changes.clear();
+        REQUIRE(b.ForEachChangeSince(instantiated, collect));
+        REQUIRE(changes.size() == 1);
+        REQUIRE(changes[0] == b.find("c"));
+        REQUIRE(b.find("c")->GetUnchecked<int>() == 4);
+    }
+
+    SECTION("Unknown changes")
+    {
+        for (unsigned i = 0; i != 1024; i += 1)
+        {
+            b.push_back(itObj, "x", i);
+        }
+        REQUIRE(b.ForEachChangeSince(start, collect));
+        changes.clear();
+
+        b.push_back(itObj, "x", 0);
+        REQUIRE(!b.ForEachChangeSince(start, collect));
+        REQUIRE(changes.empty());
+        REQUIRE(b.ForEachChangeSince(start + 1024, collect));
+        REQUIRE(changes.size() == 1);
+
+        JsonBuilder other;
+        other.TrackChanges(true);
+        REQUIRE(!other.ForEachChangeSince(b.ChangeCount(), collect));
+
+        auto const count = b.ChangeCount();
+        b.clear();
+        REQUIRE(b.ChangeCount() != count);
+        REQUIRE(!b.ForEachChangeSince(count, collect));
+
+        JsonBuilder copy(b);
+        REQUIRE(!copy.TrackChanges());
+
+        b.TrackChanges(false);
+        REQUIRE(b.ChangeCount() == 0);
+    }
+}
+
 TEST_CASE("JsonBuilder erase", "[builder]")
 {
     JsonBuilder b;
@@ -1,10 +1,19 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
+#include <climits>
+#include <cmath>
 #include <cstring>
 #include <cstdio>
+#include <ctime>
 #include <iterator>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <type_traits>
+#include <vector>
 
 #include <catch2/catch.hpp>
 #include <jsonbuilder/JsonRenderer.h>
@@ -159,6 +168,64 @@ TEST_CASE("JsonRenderer values match printf", "[renderer]")
     SECTION("bool-true") { TestBool(true); }
 }
 
+TEST_CASE("JsonRenderer float formats", "[renderer]")
+{
+    char chars[32];
+
+    auto check = [&](double n, JsonFloatFormat format, unsigned precision, std::string_view expected)
+    {
+        memset(chars, 1, sizeof(chars));
+        auto const cch = JsonRenderFloat(n, format, precision, chars);
+        REQUIRE(cch == strlen(chars));
+        REQUIRE(chars == expected);
+    };
+
+    check(3.14159, JsonFloatFixed, 2, "3.14");
+    check(-3.14159, JsonFloatFixed, 3, "-3.142");
+    check(1.5, JsonFloatFixed, 3, "1.5");
+    check(2.0, JsonFloatFixed, 3, "2");
+    check(0.125, JsonFloatFixed, 2, "0.12");
+    check(-0.001, JsonFloatFixed, 2, "0");
+    check(0.012, JsonFloatFixed, 3, "0.012");
+    check(123.456, JsonFloatFixed, 0, "123");
+    check(1e20, JsonFloatFixed, 2, "1e+20");
+    check(0.1, JsonFloatFixed, 99, "0.10000000000000001");
+    check(-1e-30, JsonFloatFixed, 17, "0");
+
+    check(3.14159, JsonFloatSignificant, 3, "3.14");
+    check(123456, JsonFloatSignificant, 3, "1.23e+05");
+    check(999.9, JsonFloatSignificant, 3, "1e+03");
+    check(0.000123456, JsonFloatSignificant, 3, "0.000123");
+    check(-0.0000123456, JsonFloatSignificant, 3, "-1.23e-05");
+    check(0.0, JsonFloatSignificant, 3, "0");
+    check(5e-324, JsonFloatSignificant, 2, "4.9e-324");
+    check(1.7976931348623157e308, JsonFloatSignificant, 0, "2e+308");
+
+    check(std::numeric_limits<double>::infinity(), JsonFloatFixed, 2, "null");
+    check(std::numeric_limits<double>::quiet_NaN(), JsonFloatSignificant, 2, "null");
+
+    // Output matches printf's %.*g and (with trailing zeros dropped) %.*f.
+    char expected[48];
+    double n = 1.0;
+    for (unsigned i = 0; i != 4000; i += 1)
+    {
+        n = n * -1.0071 + static_cast<double>(i) / 7919;
+        auto const precision = 1 + i % 17;
+        std::snprintf(expected, sizeof(expected), "%.*g", static_cast<int>(precision), n);
+        check(n, JsonFloatSignificant, precision, expected);
+
+        auto const fixed = std::ldexp(n, -static_cast<int>(i % 40));
+        if (std::fabs(fixed) < 1e12)
+        {
+            auto cch = std::snprintf(expected, sizeof(expected), "%.*f", static_cast<int>(precision), fixed);
+            while (expected[cch - 1] == '0') expected[--cch] = 0;
+            if (expected[cch - 1] == '.') expected[--cch] = 0;
+            if (strcmp(expected, "-0") == 0) strcpy(expected, "0");
+            check(fixed, JsonFloatFixed, precision, expected);
+        }
+    }
+}
+
 TEST_CASE("JsonRenderer JsonNull")
 {
     unsigned const cchBuf = 24;
@@ -218,6 +285,86 @@ TEST_CASE("JsonRenderer JsonTime", "[renderer]")
     REQUIRE(chars == "FILETIME(0xFEDCBA9876543210)"sv);
 }
 
+TEST_CASE("JsonRenderer time formats", "[renderer]")
+{
+    using namespace std::chrono_literals;
+    auto const epoch = std::chrono::system_clock::from_time_t(0);
+    auto const t = std::chrono::system_clock::from_time_t(1427940554) + std::chrono::duration_cast<std::chrono::system_clock::duration>(792765200ns);
+
+    char chars[29];
+    auto check = [&](std::chrono::system_clock::time_point value, JsonTimeFormat format, std::string_view expected)
+    {
+        memset(chars, 1, sizeof(chars));
+        auto const cch = JsonRenderTime(value, format, chars);
+        REQUIRE(cch == strlen(chars));
+        REQUIRE(chars == expected);
+    };
+
+    check(t, JsonTimeIso, "2015-04-02T02:09:14.7927652Z");
+    check(t, JsonTimeIsoMicros, "2015-04-02T02:09:14.792765Z");
+    check(t, JsonTimeIsoMillis, "2015-04-02T02:09:14.792Z");
+    check(t, JsonTimeIsoSeconds, "2015-04-02T02:09:14Z");
+    check(t, JsonTimeEpochSeconds, "1427940554");
+    check(t, JsonTimeEpochMillis, "1427940554792");
+    check(t, JsonTimeEpochMicros, "1427940554792765");
+    check(t, JsonTimeFileTime, "130724141547927652");
+
+    check(epoch, JsonTimeEpochMillis, "0");
+    check(epoch - 1ms, JsonTimeEpochSeconds, "-1");
+    check(epoch - 1ms, JsonTimeEpochMillis, "-1");
+    check(epoch - 2500ms, JsonTimeEpochSeconds, "-3");
+    check(epoch - 2500ms, JsonTimeIsoMillis, "1969-12-31T23:59:57.500Z");
+
+    REQUIRE(JsonRenderTime(TimeStruct::FromValue(0xFEDCBA9876543210), JsonTimeIsoSeconds, chars) == 28);
+    REQUIRE(chars == "FILETIME(0xFEDCBA9876543210)"sv);
+
+    JsonBuilder b;
+    b.push_back(b.root(), "t", t);
+
+    JsonRenderer renderer;
+    REQUIRE(renderer.TimeFormat() == JsonTimeIso);
+    REQUIRE(renderer.Render(b) == R"({"t":"2015-04-02T02:09:14.7927652Z"})"sv);
+    renderer.TimeFormat(JsonTimeIsoMillis);
+    REQUIRE(renderer.Render(b) == R"({"t":"2015-04-02T02:09:14.792Z"})"sv);
+    renderer.TimeFormat(JsonTimeEpochMillis);
+    REQUIRE(renderer.Render(b) == R"({"t":1427940554792})"sv);
+    REQUIRE(renderer.MeasureSize(b) == renderer.Render(b).size());
+
+    REQUIRE_THROWS_AS(renderer.TimeFormat(static_cast<JsonTimeFormat>(JsonTimeFileTime + 1)), std::invalid_argument);
+    REQUIRE(renderer.TimeFormat() == JsonTimeEpochMillis);
+}
+
+TEST_CASE("JsonRenderer time matches gmtime", "[renderer]")
+{
+    auto constexpr FileTime1970Seconds = 11644473600ll;
+    char chars[29];
+    char expected[32];
+
+    // From 1601-01-01 to 9999-12-31, with a stride that visits all months,
+    // times of day and leap years.
+    for (long long seconds1970 = -FileTime1970Seconds; seconds1970 < 253402300800ll; seconds1970 += 86400 * 13 + 3607)
+    {
+        auto const t = static_cast<std::time_t>(seconds1970);
+        std::strftime(expected, sizeof(expected), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&t));
+        auto const ft = static_cast<uint64_t>(seconds1970 + FileTime1970Seconds) * 10000000u;
+        REQUIRE(JsonRenderTime(TimeStruct::FromValue(ft), JsonTimeIsoSeconds, chars) == 20);
+        REQUIRE(std::string_view(chars) == expected);
+    }
+
+    // Renderer reuses the formatted date/time for values in the same second.
+    JsonBuilder b;
+    auto const itArray = b.push_back(b.root(), "t", JsonArray);
+    for (uint64_t ft : { 130724141540000000u, 130724141549999999u, 130724141550000000u, 130724141540000001u })
+    {
+        b.push_back(itArray, "", TimeStruct::FromValue(ft));
+    }
+
+    JsonRenderer renderer;
+    REQUIRE(renderer.Render(b) == std::string_view(
+        R"({"t":["2015-04-02T02:09:14.0000000Z","2015-04-02T02:09:14.9999999Z",)"
+        R"("2015-04-02T02:09:15.0000000Z","2015-04-02T02:09:14.0000001Z"]})"));
+}
+
 TEST_CASE("JsonRenderer JsonUuid", "[renderer]")
 {
     uuid_t uuid;
@@ -242,6 +389,163 @@ TEST_CASE("JsonRenderer JsonUuid", "[renderer]")
         REQUIRE(cch == strlen(chars));
         REQUIRE(chars == "{00010203-0405-0607-0809-0A0B0C0D0E0F}"sv);
     }
+
+    SECTION("Formats")
+    {
+        char unsigned const bytes[] = {
+            0xcd, 0x8d, 0x0a, 0x5e, 0x64, 0x09, 0x4b, 0x8e,
+            0x93, 0x66, 0xb8, 0x15, 0xce, 0xf0, 0xe3, 0x5d };
+        UuidStruct const u = UuidStruct::FromBigEndian(bytes);
+        auto check = [&](JsonUuidFormat format, std::string_view expected)
+        {
+            memset(chars, 1, sizeof(chars));
+            auto const cch = JsonRenderUuid(u.Data, format, chars);
+            REQUIRE(cch == strlen(chars));
+            REQUIRE(chars == expected);
+        };
+
+        check(JsonUuidUppercase, "CD8D0A5E-6409-4B8E-9366-B815CEF0E35D");
+        check(JsonUuidLowercase, "cd8d0a5e-6409-4b8e-9366-b815cef0e35d");
+        check(JsonUuidUppercaseCompact, "CD8D0A5E64094B8E9366B815CEF0E35D");
+        check(JsonUuidLowercaseCompact, "cd8d0a5e64094b8e9366b815cef0e35d");
+
+        JsonBuilder b;
+        b.push_back(b.root(), "id", u);
+        JsonRenderer renderer;
+        REQUIRE(renderer.UuidFormat() == JsonUuidUppercase);
+        REQUIRE(renderer.Render(b) == R"({"id":"CD8D0A5E-6409-4B8E-9366-B815CEF0E35D"})"sv);
+        renderer.UuidFormat(JsonUuidLowercaseCompact);
+        REQUIRE(renderer.Render(b) == R"({"id":"cd8d0a5e64094b8e9366b815cef0e35d"})"sv);
+    }
+}
+
+TEST_CASE("JsonRenderer JsonRenderBase64", "[renderer]")
+{
+    char chars[64];
+
+    auto check = [&](std::string_view input, std::string_view expected, JsonBinaryFormat format)
+    {
+        memset(chars, 1, sizeof(chars));
+        auto const cch = JsonRenderBase64(input.data(), input.size(), format, chars);
+        REQUIRE(cch == strlen(chars));
+        REQUIRE(chars == expected);
+    };
+
+    // RFC 4648 test vectors.
+    check("", "", JsonBinaryBase64);
+    check("f", "Zg==", JsonBinaryBase64);
+    check("fo", "Zm8=", JsonBinaryBase64);
+    check("foo", "Zm9v", JsonBinaryBase64);
+    check("foob", "Zm9vYg==", JsonBinaryBase64);
+    check("fooba", "Zm9vYmE=", JsonBinaryBase64);
+    check("foobar", "Zm9vYmFy", JsonBinaryBase64);
+    check("f", "Zg", JsonBinaryBase64Url);
+    check("fo", "Zm8", JsonBinaryBase64Url);
+    check("foobar", "Zm9vYmFy", JsonBinaryBase64Url);
+    check("\xfb\xff\xbf", "+/+/", JsonBinaryBase64);
+    check("\xfb\xff\xbf", "-_-_", JsonBinaryBase64Url);
+
+    // Long input (exercises the vectorized path, if any) vs. a simple encoder.
+    static char const Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string input;
+    for (unsigned i = 0; i != 1000; i += 1)
+    {
+        input.push_back(static_cast<char>(i * 7 + (i >> 3)));
+    }
+
+    for (size_t cb = 0; cb <= input.size(); cb += 1 + cb / 4)
+    {
+        std::string expected;
+        for (size_t i = 0; i < cb; i += 3)
+        {
+            auto const b0 = static_cast<unsigned char>(input[i]);
+            auto const b1 = i + 1 < cb ? static_cast<unsigned char>(input[i + 1]) : 0u;
+            auto const b2 = i + 2 < cb ? static_cast<unsigned char>(input[i + 2]) : 0u;
+            expected.push_back(Alphabet[b0 >> 2]);
+            expected.push_back(Alphabet[((b0 & 3) << 4) | (b1 >> 4)]);
+            expected.push_back(i + 1 < cb ? Alphabet[((b1 & 15) << 2) | (b2 >> 6)] : '=');
+            expected.push_back(i + 2 < cb ? Alphabet[b2 & 63] : '=');
+        }
+
+        std::string actual(4 * ((cb + 2) / 3) + 1, '\1');
+        auto const cch = JsonRenderBase64(input.data(), cb, JsonBinaryBase64, actual.data());
+        REQUIRE(cch == expected.size());
+        REQUIRE(actual[cch] == 0);
+        actual.resize(cch);
+        REQUIRE(actual == expected);
+    }
+}
+
+TEST_CASE("JsonRenderer JsonBinary", "[renderer]")
+{
+    std::byte const bytes[] = { std::byte{ 0xfb }, std::byte{ 0xff }, std::byte{ 0xbf }, std::byte{ 0x01 } };
+    JsonBuilder b;
+    b.push_back(b.root(), "bin", std::span(bytes));
+    b.push_back(b.root(), "empty", std::span<std::byte const>());
+
+    JsonRenderer renderer;
+    REQUIRE(renderer.BinaryFormat() == JsonBinaryBase64);
+    REQUIRE(renderer.Render(b) == R"({"bin":"+/+/AQ==","empty":""})"sv);
+
+    renderer.BinaryFormat(JsonBinaryBase64Url);
+    REQUIRE(renderer.BinaryFormat() == JsonBinaryBase64Url);
+    REQUIRE(renderer.Render(b) == R"({"bin":"-_-_AQ","empty":""})"sv);
+}
+
+TEST_CASE("JsonRenderer JsonDecimal", "[renderer]")
+{
+    char chars[40];
+
+    auto check = [&](long long signed mantissa, signed int scale, std::string_view expected)
+    {
+        memset(chars, 1, sizeof(chars));
+        auto const cch = JsonRenderDecimal(DecimalStruct::FromValue(mantissa, scale), chars);
+        REQUIRE(cch == strlen(chars));
+        REQUIRE(chars == expected);
+    };
+
+    check(0, 0, "0");
+    check(0, 2, "0.00");
+    check(0, -3, "0");
+    check(12345, 2, "123.45");
+    check(-150, 2, "-1.50");
+    check(5, 3, "0.005");
+    check(-123, 8, "-0.00000123");
+    check(123, 9, "1.23e-7");
+    check(1, 10, "1e-10");
+    check(12, -3, "12e3");
+    check(INT64_MIN, 0, "-9223372036854775808");
+    check(INT64_MIN, 19, "-0.9223372036854775808");
+    check(INT64_MIN, 2147483647, "-9.223372036854775808e-2147483629");
+    check(INT64_MAX, -2147483647 - 1, "9223372036854775807e2147483648");
+
+    JsonBuilder b;
+    b.push_back(b.root(), "price", DecimalStruct::FromValue(1999, 2));
+    JsonRenderer renderer;
+    REQUIRE(renderer.Render(b) == R"({"price":19.99})"sv);
+}
+
+TEST_CASE("JsonRenderer FloatFormat", "[renderer]")
+{
+    double const doubles[] = { 1.0 / 3, 2.5 };
+    JsonBuilder b;
+    b.push_back(b.root(), "f", 2.0 / 3);
+    b.push_back(b.root(), "a", std::span(doubles));
+
+    JsonRenderer renderer;
+    REQUIRE(renderer.FloatFormat() == JsonFloatShortest);
+    REQUIRE(renderer.FloatPrecision() == 6);
+    REQUIRE(renderer.Render(b) == R"({"f":0.6666666666666666,"a":[0.3333333333333333,2.5]})"sv);
+
+    renderer.FloatFormat(JsonFloatFixed);
+    renderer.FloatPrecision(2);
+    REQUIRE(renderer.Render(b) == R"({"f":0.67,"a":[0.33,2.5]})"sv);
+
+    renderer.FloatFormat(JsonFloatSignificant);
+    renderer.FloatPrecision(100);
+    REQUIRE(renderer.FloatPrecision() == 17);
+    renderer.FloatPrecision(4);
+    REQUIRE(renderer.Render(b) == R"({"f":0.6667,"a":[0.3333,2.5]})"sv);
 }
 
 TEST_CASE("JsonRenderer full object", "[renderer]")
@@ -292,3 +596,757 @@ TEST_CASE("JsonRenderer full object", "[renderer]")
         REQUIRE(renderString == expectedString);
     }
 }
+
+TEST_CASE("JsonRenderer indentation", "[renderer]")
+{
+    JsonBuilder b;
+    auto itObj = b.push_back(b.root(), "obj", JsonObject);
+    auto itArr = b.push_back(itObj, "arr", JsonArray);
+    b.push_back(itArr, "", 1);
+    std::vector<int32_t> const ints{ 2, 3 };
+    b.push_back(itArr, "", std::span<int32_t const>(ints));
+
+    JsonRenderer renderer(true);
+    REQUIRE(renderer.IndentChar() == ' ');
+    REQUIRE(renderer.Render(b) ==
+        "{\n  \"obj\": {\n    \"arr\": [\n      1,\n      [\n        2,\n        3\n      ]\n    ]\n  }\n}");
+
+    REQUIRE_THROWS_AS(renderer.IndentChar('x'), std::invalid_argument);
+    REQUIRE(renderer.IndentChar() == ' ');
+
+    renderer.IndentChar('\t');
+    renderer.IndentSpaces(1);
+    REQUIRE(renderer.IndentChar() == '\t');
+    REQUIRE(renderer.Render(b) ==
+        "{\n\t\"obj\": {\n\t\t\"arr\": [\n\t\t\t1,\n\t\t\t[\n\t\t\t\t2,\n\t\t\t\t3\n\t\t\t]\n\t\t]\n\t}\n}");
+
+    renderer.NewLine("\r\n");
+    renderer.IndentSpaces(12);
+    auto const rendered = renderer.Render(b);
+    REQUIRE(rendered.substr(0, 16) == "{\r\n\t\t\t\t\t\t\t\t\t\t\t\t\"");
+    REQUIRE(renderer.MeasureSize(b) == rendered.size());
+}
+
+TEST_CASE("JsonRenderer NameCache", "[renderer]")
+{
+    JsonBuilder b;
+    for (unsigned i = 0; i != 1100; i += 1)
+    {
+        auto itObj = b.push_back(b.root(), "", JsonObject);
+        auto const name = "key\t" + std::to_string(i % 1050);
+        b.push_back(itObj, name, i);
+        b.push_back(itObj, "q\"uote", true);
+        b.push_back(itObj, "plain", false);
+        b.push_back(itObj, "", JsonNull);
+    }
+
+    for (bool pretty : { false, true })
+    {
+        JsonRenderer renderer(pretty);
+        std::string const expected(renderer.Render(b));
+
+        renderer.NameCache(true);
+        REQUIRE(renderer.NameCache());
+        REQUIRE(renderer.Render(b) == expected);
+        REQUIRE(renderer.Render(b) == expected);
+
+        // Switching Pretty clears the cached tokens.
+        renderer.Pretty(!pretty);
+        REQUIRE(renderer.Render(b) == JsonRenderer(!pretty).Render(b));
+        REQUIRE(renderer.NameCache());
+    }
+
+    JsonRenderer renderer;
+    renderer.NameCache(true);
+    JsonBuilder small;
+    small.push_back(small.root(), "a\"b", 1);
+    small.push_back(small.root(), "a\"b", 2);
+    small.push_back(small.root(), "a\"c", 3);
+    REQUIRE(renderer.Render(small) == R"({"a\"b":1,"a\"b":2,"a\"c":3})");
+}
+
+TEST_CASE("JsonRenderer string escaping", "[renderer]")
+{
+    JsonBuilder b;
+    b.push_back(b.root(), "plain", "text \u00E9");
+    b.push_back(b.root(), "q\"name", "x");
+    b.push_back(b.root(), "value", "a\"b\\c\n\x01");
+    b.push_back(b.root(), "utf16", u"tab\t");
+    b.push_back(b.root(), "appended", "ok");
+    b.append_to_last("\r");
+    auto itModified = b.push_back(b.root(), "modified", "abc");
+    static_cast<char*>(itModified->Data())[1] = '"';
+
+    JsonRenderer renderer;
+    REQUIRE(
+        renderer.Render(b) ==
+        "{\"plain\":\"text \u00E9\",\"q\\\"name\":\"x\","
+        "\"value\":\"a\\\"b\\\\c\\n\\u0001\",\"utf16\":\"tab\\t\","
+        "\"appended\":\"ok\\r\",\"modified\":\"a\\\"c\"}");
+}
+
+static std::string ReferenceEscape(std::string_view value)
+{
+    std::string result = "\"";
+    for (auto ch : value)
+    {
+        char buf[7];
+        switch (ch)
+        {
+        case '"': result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case 8: result += "\\b"; break;
+        case 9: result += "\\t"; break;
+        case 10: result += "\\n"; break;
+        case 12: result += "\\f"; break;
+        case 13: result += "\\r"; break;
+        default:
+            if (static_cast<unsigned char>(ch) < 0x20)
+            {
+                snprintf(buf, sizeof(buf), "\\u%04X", static_cast<unsigned char>(ch));
+                result += buf;
+            }
+            else
+            {
+                result += ch;
+            }
+            break;
+        }
+    }
+    result += '"';
+    return result;
+}
+
+TEST_CASE("JsonRenderer string escaping blocks", "[renderer]")
+{
+    JsonRenderer renderer;
+
+    // Every byte value at every position of strings that span the block size.
+    for (unsigned len = 1; len != 40; len += 1)
+    {
+        for (unsigned pos = 0; pos != len; pos += 1)
+        {
+            for (unsigned ch = 0; ch != 256; ch += 1)
+            {
+                std::string value(len, 'a');
+                value[pos] = static_cast<char>(ch);
+
+                JsonBuilder b;
+                b.push_back(b.root(), "", value);
+                b.root().begin()->Data(); // Clear escape-free flag.
+                REQUIRE(renderer.Render(b.root().begin()) == ReferenceEscape(value));
+            }
+        }
+    }
+
+    std::string mixed;
+    for (unsigned i = 0; i != 1000; i += 1)
+    {
+        mixed += static_cast<char>((i * 37) % 256);
+    }
+    JsonBuilder b;
+    b.push_back(b.root(), "", mixed);
+    REQUIRE(renderer.Render(b.root().begin()) == ReferenceEscape(mixed));
+}
+
+TEST_CASE("JsonRenderer string escaping benchmark", "[.][benchmark]")
+{
+    std::string ascii;
+    std::string utf8;
+    std::string control;
+    for (unsigned i = 0; i != 4096; i += 1)
+    {
+        ascii += static_cast<char>('a' + i % 26);
+        utf8 += i % 4 ? static_cast<char>('a' + i % 26) : static_cast<char>(0xC3 + i % 2);
+        control += i % 3 ? static_cast<char>('a' + i % 26) : static_cast<char>(i % 0x20);
+    }
+
+    JsonBuilder b;
+    b.push_back(b.root(), "ascii", ascii);
+    b.push_back(b.root(), "utf8", utf8);
+    b.push_back(b.root(), "control", control);
+    for (auto& value : b.root())
+    {
+        value.Data(); // Clear escape-free flag so RenderString is used.
+    }
+
+    JsonRenderer renderer;
+    auto it = b.root().begin();
+    BENCHMARK("ascii") { return renderer.Render(it).size(); };
+    ++it;
+    BENCHMARK("utf8") { return renderer.Render(it).size(); };
+    ++it;
+    BENCHMARK("control") { return renderer.Render(it).size(); };
+}
+
+TEST_CASE("JsonRenderer sink", "[renderer]")
+{
+    JsonBuilder b;
+    auto itArray = b.push_back(b.root(), "array", JsonArray);
+    for (int i = 0; i != 200; i += 1)
+    {
+        b.push_back(itArray, "", i);
+    }
+    b.push_back(b.root(), "name", "value\n");
+    std::vector<double> doubles(20000, 1.5);
+    b.push_back(b.root(), "doubles", std::span<double const>(doubles));
+
+    for (bool pretty : { false, true })
+    {
+        JsonRenderer renderer(pretty);
+        std::string const expected(renderer.Render(b));
+
+        for (JsonRenderer::size_type chunkSize : { 1u, 7u, 100u, 65536u })
+        {
+            renderer.ChunkSize(chunkSize);
+            std::vector<std::string> chunks;
+            JsonCallbackSink sink([&](std::string_view chunk) { chunks.emplace_back(chunk); });
+            renderer.Render(b, sink);
+            REQUIRE(renderer.Size() == 0);
+
+            std::string actual;
+            for (size_t i = 0; i != chunks.size(); i += 1)
+            {
+                if (i + 1 != chunks.size())
+                {
+                    REQUIRE(chunks[i].size() == chunkSize);
+                }
+                else
+                {
+                    REQUIRE(!chunks[i].empty());
+                    REQUIRE(chunks[i].size() <= chunkSize);
+                }
+                actual += chunks[i];
+            }
+            REQUIRE(actual == expected);
+        }
+
+        renderer.ChunkSize(256);
+        std::ostringstream stream;
+        JsonOstreamSink ostreamSink(stream);
+        renderer.Render(b.root().begin(), ostreamSink);
+        REQUIRE(stream.str() == renderer.Render(b.root().begin()));
+    }
+
+    SECTION("Bounded buffer")
+    {
+        JsonRenderer renderer;
+        renderer.ChunkSize(256);
+        std::string actual;
+        JsonCallbackSink sink([&](std::string_view chunk) { actual += chunk; });
+        renderer.Render(b, sink);
+        REQUIRE(actual == JsonRenderer().Render(b));
+        REQUIRE(renderer.Capacity() < actual.size());
+    }
+
+    SECTION("Sink exception")
+    {
+        JsonRenderer renderer;
+        renderer.ChunkSize(16);
+        JsonCallbackSink sink([](std::string_view) { throw std::runtime_error("sink"); });
+        REQUIRE_THROWS_AS(renderer.Render(b, sink), std::runtime_error);
+        REQUIRE(renderer.Render(b).size() != 0);
+    }
+}
+
+TEST_CASE("JsonRenderer MeasureSize", "[renderer]")
+{
+    JsonBuilder b;
+    REQUIRE(JsonRenderer().MeasureSize(b) == 2);
+
+    auto itObj = b.push_back(b.root(), "obj", JsonObject);
+    b.push_back(itObj, "empty", JsonArray);
+    b.push_back(itObj, "esc\"aped\x01", "a\tb\\c\x1F\u00E9");
+    b.push_back(itObj, "plain", "text");
+    b.push_back(itObj, "null", JsonNull);
+    b.push_back(itObj, "true", true);
+    b.push_back(itObj, "false", false);
+    auto itArr = b.push_back(b.root(), "arr", JsonArray);
+    for (long long n : { 0ll, 9ll, 10ll, -1ll, -10ll, 123456789ll, LLONG_MIN, LLONG_MAX })
+    {
+        b.push_back(itArr, "", n);
+    }
+    for (unsigned long long n : { 0ull, 9999ull, 10000ull, ULLONG_MAX })
+    {
+        b.push_back(itArr, "", n);
+    }
+    b.push_back(itArr, "", 0.1);
+    b.push_back(itArr, "", -1.5e300);
+    b.push_back(itArr, "", std::numeric_limits<double>::infinity());
+    b.push_back(itArr, "", TimeStruct::FromValue(130724141547927652));
+    b.push_back(itArr, "", TimeStruct::FromValue(~0ull));
+    b.push_back(itArr, "", DecimalStruct::FromValue(-12345, 3));
+    b.push_back(itArr, "", UuidStruct{});
+    for (unsigned cb = 0; cb != 5; cb += 1)
+    {
+        b.push_back(itArr, "", JsonBinary, cb, "\x01\x02\x03\x04");
+    }
+    std::vector<int32_t> const ints{ -5, 0, 100000, INT32_MIN };
+    std::vector<uint64_t> const uints{ 0, 10, UINT64_MAX };
+    std::vector<float> const floats{ 0.1f, -2.5f };
+    std::vector<double> const doubles{ 1.0 / 3.0 };
+    std::vector<double> const noDoubles;
+    b.push_back(itArr, "", std::span<int32_t const>(ints));
+    b.push_back(itArr, "", std::span<uint64_t const>(uints));
+    b.push_back(itArr, "", std::span<float const>(floats));
+    b.push_back(itArr, "", std::span<double const>(doubles));
+    b.push_back(itArr, "", std::span<double const>(noDoubles));
+    b.push_back(itArr, "", JsonType(5), 6, "custom");
+
+    for (bool pretty : { false, true })
+    {
+        for (auto format : { JsonFloatShortest, JsonFloatFixed })
+        {
+            for (auto timeFormat : { JsonTimeIso, JsonTimeIsoMillis, JsonTimeEpochMillis })
+            {
+                for (auto binaryFormat : { JsonBinaryBase64, JsonBinaryBase64Url })
+                {
+                    JsonRenderer renderer(pretty, "\r\n", 3);
+                    renderer.FloatFormat(format);
+                    renderer.TimeFormat(timeFormat);
+                    renderer.BinaryFormat(binaryFormat);
+                    renderer.UuidFormat(pretty ? JsonUuidLowercaseCompact : JsonUuidUppercase);
+
+                    auto const cch = renderer.MeasureSize(b);
+                    REQUIRE(cch == renderer.Render(b).size());
+                    REQUIRE(renderer.MeasureSize(itArr) == renderer.Render(itArr).size());
+                    for (auto it = itObj.begin(); it != itObj.end(); ++it)
+                    {
+                        REQUIRE(renderer.MeasureSize(it) == renderer.Render(it).size());
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("JsonRenderer RenderTo", "[renderer]")
+{
+    JsonBuilder b;
+    b.push_back(b.root(), "str", "value\n");
+    b.push_back(b.root(), "num", 123);
+    std::vector<double> const doubles{ 1.5, 2.5, 3.5 };
+    b.push_back(b.root(), "doubles", std::span<double const>(doubles));
+
+    JsonRenderer renderer;
+    std::string const expected(renderer.Render(b));
+    auto const previous = renderer.Render(b.root().begin());
+
+    for (size_t cchDest = 0; cchDest != expected.size() + 3; cchDest += 1)
+    {
+        std::vector<char> dest(cchDest + 1, '?');
+        auto const result = renderer.RenderTo(b, dest.data(), cchDest);
+        REQUIRE(result.Size == expected.size());
+        REQUIRE(result.Truncated == (cchDest < expected.size()));
+        if (!result.Truncated)
+        {
+            REQUIRE(std::string_view(dest.data(), result.Size) == expected);
+            REQUIRE(dest[result.Size] == (result.Size < cchDest ? '\0' : '?'));
+        }
+        REQUIRE(dest[cchDest] == '?');
+    }
+
+    // The string from the previous Render call is unchanged.
+    REQUIRE(previous == "\"value\\n\"");
+
+    char dest[64];
+    auto const itNum = std::next(b.root().begin());
+    auto const result = renderer.RenderTo(itNum, dest, sizeof(dest));
+    REQUIRE(!result.Truncated);
+    REQUIRE(std::string_view(dest, result.Size) == "123");
+}
+
+TEST_CASE("JsonRenderer deep nesting", "[renderer]")
+{
+    unsigned const depth = 100000;
+    JsonBuilder b;
+    auto it = b.root();
+    for (unsigned i = 0; i != depth; i += 1)
+    {
+        it = b.push_back(it, "a", i % 2 ? JsonObject : JsonArray);
+    }
+    b.push_back(it, "", 1);
+
+    std::string expected = "{";
+    for (unsigned i = 0; i != depth; i += 1)
+    {
+        expected += i % 2 ? "{" : "\"a\":[";
+    }
+    expected += "\"\":1";
+    for (unsigned i = depth; i != 0; i -= 1)
+    {
+        expected += (i - 1) % 2 ? "}" : "]";
+    }
+    expected += "}";
+
+    JsonRenderer renderer;
+    REQUIRE(renderer.Render(b) == expected);
+    REQUIRE(renderer.MeasureSize(b) == expected.size());
+
+    renderer.Pretty(true);
+    renderer.IndentSpaces(0);
+    REQUIRE(renderer.MeasureSize(b) == renderer.Render(b).size());
+
+    renderer.MaxDepth(depth + 1);
+    REQUIRE(renderer.Render(b).size() != 0);
+    renderer.MaxDepth(depth);
+    REQUIRE_THROWS_AS(renderer.Render(b), std::length_error);
+    REQUIRE_THROWS_AS(renderer.MeasureSize(b), std::length_error);
+    REQUIRE(renderer.Render(b.root().begin()).size() != 0);
+
+    renderer.MaxDepth(1);
+    JsonBuilder flat;
+    flat.push_back(flat.root(), "a", 1);
+    flat.push_back(flat.root(), "b", JsonObject);
+    REQUIRE_THROWS_AS(renderer.Render(flat), std::length_error);
+    JsonBuilder empty;
+    REQUIRE(renderer.Render(empty) == "{}");
+}
+
+namespace
+{
+    class DerivedRenderer : public JsonRenderer
+    {
+      protected:
+        void RenderCustom(RenderBuffer& buffer, iterator const& itValue) override
+        {
+            buffer.append("\"virtual:", 9);
+            buffer.append(static_cast<char const*>(itValue->Data()), itValue->DataSize());
+            buffer.push_back('"');
+        }
+    };
+
+    void RenderCustomPoint(
+        void* context,
+        JsonInternal::PodVector<char>& buffer,
+        JsonBuilder::const_iterator const& itValue)
+    {
+        *static_cast<unsigned*>(context) += 1;
+        buffer.push_back('[');
+        buffer.append(static_cast<char const*>(itValue->Data()), itValue->DataSize());
+        buffer.push_back(']');
+    }
+}
+
+TEST_CASE("JsonRenderer CustomRenderer", "[renderer]")
+{
+    auto const JsonPoint = static_cast<JsonType>(1);
+    auto const JsonOther = static_cast<JsonType>(200);
+
+    JsonBuilder b;
+    b.push_back(b.root(), "p", JsonPoint, 3, "1,2");
+    b.push_back(b.root(), "o", JsonOther, 1, "x");
+
+    DerivedRenderer renderer;
+    REQUIRE(renderer.CustomRenderer(JsonPoint) == nullptr);
+    REQUIRE(renderer.Render(b) == R"({"p":"virtual:1,2","o":"virtual:x"})");
+
+    unsigned calls = 0;
+    renderer.CustomRenderer(JsonPoint, RenderCustomPoint, &calls);
+    REQUIRE(renderer.CustomRenderer(JsonPoint) == RenderCustomPoint);
+    REQUIRE(renderer.Render(b) == R"({"p":[1,2],"o":"virtual:x"})");
+    REQUIRE(calls == 1);
+    REQUIRE(renderer.MeasureSize(b) == renderer.Render(b).size());
+
+    renderer.CustomRenderer(JsonOther, RenderCustomPoint, &calls);
+    REQUIRE(renderer.Render(b) == R"({"p":[1,2],"o":[x]})");
+
+    renderer.CustomRenderer(JsonPoint, nullptr);
+    REQUIRE(renderer.CustomRenderer(JsonPoint) == nullptr);
+    REQUIRE(renderer.Render(b) == R"({"p":"virtual:1,2","o":[x]})");
+
+    REQUIRE_THROWS_AS(renderer.CustomRenderer(JsonType(0), RenderCustomPoint), std::invalid_argument);
+    REQUIRE_THROWS_AS(renderer.CustomRenderer(JsonType(201), RenderCustomPoint), std::invalid_argument);
+    REQUIRE_THROWS_AS(renderer.CustomRenderer(JsonUtf8, nullptr), std::invalid_argument);
+}
+
+TEST_CASE("JsonRenderer ThreadCount", "[renderer]")
+{
+    auto const JsonPoint = static_cast<JsonType>(7);
+
+    JsonBuilder b;
+    auto itItems = b.push_back(b.push_back(b.root(), "items", JsonObject), "list", JsonArray);
+    for (unsigned i = 0; i != 20000; i += 1)
+    {
+        auto itObj = b.push_back(itItems, "", JsonObject);
+        b.push_back(itObj, "id", i);
+        b.push_back(itObj, "name", "item\t" + std::to_string(i));
+        b.push_back(itObj, "point", JsonPoint, 3, "1,2");
+        auto itArr = b.push_back(itObj, "values", JsonArray);
+        for (unsigned j = 0; j != i % 5; j += 1)
+        {
+            b.push_back(itArr, "", j * 0.5);
+        }
+    }
+
+    JsonBuilder flat;
+    for (unsigned i = 0; i != 20000; i += 1)
+    {
+        flat.push_back(flat.root(), "key" + std::to_string(i), i);
+    }
+
+    for (bool pretty : { false, true })
+    {
+        JsonRenderer serial(pretty);
+        serial.NameCache(true);
+        std::string const expected(serial.Render(b));
+        std::string const expectedFlat(serial.Render(flat));
+        std::string const expectedItems(serial.Render(itItems));
+
+        for (unsigned threadCount : { 2u, 3u, 8u })
+        {
+            JsonRenderer renderer(pretty);
+            renderer.NameCache(true);
+            renderer.ThreadCount(threadCount);
+            REQUIRE(renderer.ThreadCount() == threadCount);
+            REQUIRE(renderer.Render(b) == expected);
+            REQUIRE(renderer.Render(flat) == expectedFlat);
+            REQUIRE(renderer.Render(itItems) == expectedItems);
+
+            std::vector<char> dest(expected.size() + 1);
+            auto const result = renderer.RenderTo(b, dest.data(), dest.size());
+            REQUIRE(!result.Truncated);
+            REQUIRE(std::string_view(dest.data(), result.Size) == expected);
+        }
+    }
+
+    SECTION("Custom types and depth")
+    {
+        DerivedRenderer renderer;
+        renderer.ThreadCount(4);
+        std::string const expected(static_cast<JsonRenderer&>(renderer).Render(b));
+        REQUIRE(expected.find("\"virtual:1,2\"") != std::string::npos);
+
+        struct ThreadIds
+        {
+            std::mutex mutex;
+            std::set<std::thread::id> ids;
+        } threadIds;
+        renderer.CustomRenderer(
+            JsonPoint,
+            [](void* context, JsonInternal::PodVector<char>& buffer, JsonBuilder::const_iterator const&) {
+                auto const pThreadIds = static_cast<ThreadIds*>(context);
+                std::lock_guard<std::mutex> lock(pThreadIds->mutex);
+                pThreadIds->ids.insert(std::this_thread::get_id());
+                buffer.append("[1,2]", 5);
+            },
+            &threadIds);
+        renderer.MaxDepth(5);
+        REQUIRE(renderer.Render(b).find("\"point\":[1,2]") != std::string::npos);
+        REQUIRE(threadIds.ids.size() == 4);
+
+        renderer.MaxDepth(4);
+        REQUIRE_THROWS_AS(renderer.Render(b), std::length_error);
+        renderer.MaxDepth(3);
+        REQUIRE_THROWS_AS(renderer.Render(b), std::length_error);
+    }
+}
+
+TEST_CASE("JsonRenderer ThreadCount structure selection", "[renderer]")
+{
+    auto const JsonPoint = static_cast<JsonType>(7);
+
+    struct ThreadIds
+    {
+        std::mutex mutex;
+        std::set<std::thread::id> ids;
+    } threadIds;
+    auto const countThreads = [&](JsonBuilder const& builder) {
+        threadIds.ids.clear();
+        DerivedRenderer serial;
+        JsonRenderer renderer;
+        renderer.ThreadCount(4);
+        renderer.CustomRenderer(
+            JsonPoint,
+            [](void* context, JsonInternal::PodVector<char>& buffer, JsonBuilder::const_iterator const&) {
+                auto const pThreadIds = static_cast<ThreadIds*>(context);
+                std::lock_guard<std::mutex> lock(pThreadIds->mutex);
+                pThreadIds->ids.insert(std::this_thread::get_id());
+                buffer.append("\"virtual:1,2\"", 13);
+            },
+            &threadIds);
+        REQUIRE(renderer.Render(builder) == static_cast<JsonRenderer&>(serial).Render(builder));
+        return threadIds.ids.size();
+    };
+
+    // A field before the payload does not prevent splitting the payload.
+    JsonBuilder envelope;
+    envelope.push_back(envelope.root(), "version", 1);
+    auto itList = envelope.push_back(envelope.root(), "items", JsonArray);
+    for (unsigned i = 0; i != 20000; i += 1)
+    {
+        auto itObj = envelope.push_back(itList, "", JsonObject);
+        envelope.push_back(itObj, "id", i);
+        envelope.push_back(itObj, "point", JsonPoint, 3, "1,2");
+    }
+    REQUIRE(countThreads(envelope) == 4);
+
+    // Children stored in reverse order: large structures are still
+    // split, and small ones are not.
+    JsonBuilder reversed;
+    itList = reversed.push_back(reversed.root(), "items", JsonArray);
+    for (unsigned i = 0; i != 20000; i += 1)
+    {
+        auto itObj = reversed.push_front(itList, "", JsonObject);
+        reversed.push_back(itObj, "id", i);
+        reversed.push_front(itObj, "point", JsonPoint, 3, "1,2");
+    }
+    REQUIRE(countThreads(reversed) == 4);
+
+    JsonBuilder small;
+    for (unsigned i = 0; i != 10; i += 1)
+    {
+        auto itObj = small.push_front(small.root(), "k", JsonObject);
+        small.push_back(itObj, "point", JsonPoint, 3, "1,2");
+    }
+    REQUIRE(countThreads(small) == 1);
+}
+
+TEST_CASE("JsonRenderer RenderCache", "[renderer]")
+{
+    auto const JsonPoint = static_cast<JsonType>(9);
+
+    for (bool pretty : { false, true })
+    {
+        JsonBuilder b;
+        b.TrackChanges(true);
+        auto itSeq = b.push_back(b.root(), "seq", 1u);
+        auto itItems = b.push_back(b.root(), "items", JsonArray);
+        for (unsigned i = 0; i != 100; i += 1)
+        {
+            auto itObj = b.push_back(itItems, "", JsonObject);
+            b.push_back(itObj, "id", i);
+            b.push_back(itObj, "point", JsonPoint, 3, "1,2");
+            auto itTags = b.push_back(itObj, "tags", JsonArray);
+            b.push_back(itTags, "", "t\t" + std::to_string(i));
+        }
+        auto itEmpty = b.push_back(b.root(), "empty", JsonObject);
+
+        unsigned calls = 0;
+        JsonRenderer renderer(pretty);
+        renderer.CustomRenderer(JsonPoint, RenderCustomPoint, &calls);
+        renderer.RenderCache(true);
+        REQUIRE(renderer.RenderCache());
+
+        JsonRenderer reference(pretty);
+        reference.CustomRenderer(JsonPoint, RenderCustomPoint, &calls);
+        auto const check = [&]() {
+            std::string const expected(reference.Render(b));
+            REQUIRE(renderer.Render(b) == expected);
+        };
+
+        check();
+        REQUIRE(calls == 200);
+
+        // Unchanged items are copied from the previous output.
+        calls = 0;
+        *static_cast<unsigned*>(b.MutableData(itSeq)) = 2;
+        REQUIRE(renderer.Render(b).find(pretty ? "\"seq\": 2" : "\"seq\":2") != std::string_view::npos);
+        REQUIRE(calls == 0);
+
+        auto itItem = itItems.begin();
+        std::advance(itItem, 50);
+        b.push_back(itItem, "added", true);
+        renderer.Render(b);
+        REQUIRE(calls == 1);
+        check();
+
+        std::advance(itItem, 1);
+        b.erase(itItem);
+        b.push_back(itEmpty, "x", JsonNull);
+        check();
+
+        auto itTags = itItems.begin().begin();
+        std::advance(itTags, 2);
+        b.splice_back(itTags, itEmpty);
+        b.splice_front(itItems.begin(), b.root());
+        check();
+
+        b.push_back(b.root(), "s", "abc");
+        b.append_to_last("\n");
+        check();
+
+        // Settings changes and other renders start over.
+        renderer.UuidFormat(JsonUuidLowercase);
+        reference.UuidFormat(JsonUuidLowercase);
+        calls = 0;
+        check();
+        REQUIRE(calls == 2 * 99);
+        renderer.Render(b.root());
+        check();
+
+        JsonBuilder other(b);
+        other.TrackChanges(true);
+        other.push_back(other.root(), "other", 1);
+        REQUIRE(renderer.Render(other) == reference.Render(other));
+        check();
+
+        b.clear();
+        b.push_back(b.root(), "a", 1);
+        check();
+    }
+}
+
+TEST_CASE("JsonRenderer packed arrays", "[renderer]")
+{
+    int32_t const ints[] = { -2147483647 - 1, 0, 7 };
+    uint64_t const uints[] = { 18446744073709551615u, 1 };
+    float const floats[] = { 0.5f, -3 };
+    double const doubles[] = { 1.25, -1e300, std::numeric_limits<double>::infinity() };
+
+    // Equivalent content using one node per element.
+    JsonBuilder expected;
+    auto it = expected.push_back(expected.root(), "ints", JsonArray);
+    for (auto n : ints) expected.push_back(it, "", n);
+    it = expected.push_back(expected.root(), "uints", JsonArray);
+    for (auto n : uints) expected.push_back(it, "", n);
+    it = expected.push_back(expected.root(), "floats", JsonArray);
+    for (auto n : floats) expected.push_back(it, "", n);
+    it = expected.push_back(expected.root(), "doubles", JsonArray);
+    for (auto n : doubles) expected.push_back(it, "", n);
+    expected.push_back(expected.root(), "empty", JsonArray);
+
+    JsonBuilder packed;
+    packed.push_back(packed.root(), "ints", std::span(ints));
+    packed.push_back(packed.root(), "uints", std::span(uints));
+    packed.push_back(packed.root(), "floats", std::span(floats));
+    packed.push_back(packed.root(), "doubles", std::span(doubles));
+    packed.push_back(packed.root(), "empty", std::span<int64_t const>());
+
+    SECTION("Default renderer")
+    {
+        JsonRenderer renderer;
+        std::string expectedString{ renderer.Render(expected) };
+        REQUIRE(renderer.Render(packed) == expectedString);
+        REQUIRE(
+            expectedString ==
+            R"({"ints":[-2147483648,0,7],"uints":[18446744073709551615,1],"floats":[0.5,-3],"doubles":[1.25,-1e+300,null],"empty":[]})");
+    }
+
+    SECTION("Pretty renderer")
+    {
+        JsonRenderer renderer(true, "\r\n", 3);
+        std::string expectedString{ renderer.Render(expected) };
+        REQUIRE(renderer.Render(packed) == expectedString);
+    }
+
+    SECTION("Large array")
+    {
+        std::vector<double> values(10000);
+        for (size_t i = 0; i != values.size(); i += 1)
+        {
+            values[i] = static_cast<double>(i) / 3;
+        }
+
+        JsonBuilder large;
+        auto itLarge = large.push_back(large.root(), "values", JsonArray);
+        for (auto n : values) large.push_back(itLarge, "", n);
+
+        JsonBuilder largePacked;
+        largePacked.push_back(largePacked.root(), "values", std::span(values));
+
+        JsonRenderer renderer(true);
+        std::string expectedString{ renderer.Render(large) };
+        REQUIRE(renderer.Render(largePacked) == expectedString);
+    }
+}